@@ -0,0 +1,24 @@
+#!/bin/bash
+
+LIST="call counter loop while"
+ENGINES=("" "--vm")
+TIMEFORMAT="%R s"
+
+make build-notest
+
+for engine in "${ENGINES[@]}"; do
+    for e in $LIST; do
+        echo "Bench $e $engine"
+        time ./tkom.out $engine < "tests/bench/$e.in" > /dev/null
+    done
+done
+
+# Scanner throughput over a large script made of repeated test programs
+SCAN_INPUT=$(mktemp)
+for i in $(seq 1 2000); do cat tests/in/*.in; done > "$SCAN_INPUT"
+SIZE=$(wc -c < "$SCAN_INPUT")
+START=$(date +%s%N)
+./tkom.out --scan-only "$SCAN_INPUT" > /dev/null
+END=$(date +%s%N)
+echo "Bench scanner: $((SIZE * 1000 / (END - START))) MB/s"
+rm "$SCAN_INPUT"
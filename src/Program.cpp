@@ -4,11 +4,28 @@
 
 void Program::run() {
   try {
-    Parser parser(in);
-    auto code = parser.parse();
-
-    auto global = makeGlobalContext();
-    auto result = code->exec(global);
+    auto parser = in != nullptr
+                      ? std::make_unique<Parser>(*in)
+                      : std::make_unique<Parser>(sourceBegin, sourceEnd);
+    auto code = parser->parse();
+    Optimizer optimizer(optimizerLog, inlineSize);
+    optimizer.optimize(*code);
+
+    auto layout = std::make_shared<FrameLayout>();
+    code->resolveScope(*layout);
+
+    auto global = makeGlobalContext(layout);
+    if (engine == Engine::Bytecode) {
+      bytecode::Compiler compiler;
+      auto module = compiler.compile(*code);
+      bytecode::VirtualMachine vm(
+          *module, maxDepth != 0 ? maxDepth
+                                 : bytecode::VirtualMachine::defaultMaxDepth);
+      vm.run(global);
+    } else {
+      if (maxDepth != 0) global->setMaxCallDepth(maxDepth);
+      code->execStatement(global);
+    }
   } catch (ParserExceptionBase e) {
     std::cout << e.what() << std::endl;
   } catch (ExecuteExceptionBase e) {
@@ -16,8 +33,10 @@ void Program::run() {
   }
 }
 
-std::shared_ptr<Context> Program::makeGlobalContext() {
+std::shared_ptr<Context> Program::makeGlobalContext(
+    std::shared_ptr<const FrameLayout> layout) {
   auto ctx = std::make_shared<Context>();
+  ctx->setLayout(layout);
 
   auto print = std::make_shared<PrintFunction>(out);
   ctx->setFunction(print->instrName(), print);
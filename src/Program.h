@@ -9,17 +9,44 @@
 #include <utility>
 
 #include "parser/Parser.h"
+#include "bytecode/Compiler.h"
+#include "bytecode/VirtualMachine.h"
 #include "execute/BuiltInFunc.h"
 #include "execute/Context.h"
+#include "execute/Optimizer.h"
 
 class Program {
+ public:
+  enum class Engine { TreeWalker, Bytecode };
+
  private:
-  std::istream &in;
+  // Program is read from the stream, or from the source range when it is
+  // nullptr
+  std::istream *in = nullptr;
+  const char *sourceBegin = nullptr;
+  const char *sourceEnd = nullptr;
   std::ostream &out;
-  std::shared_ptr<Context> makeGlobalContext();
+  Engine engine;
+  std::ostream *optimizerLog = nullptr;
+  std::size_t inlineSize = Optimizer::defaultInlineSize;
+  // Limit of nested script calls, 0 means the default of the engine
+  std::size_t maxDepth = 0;
+  std::shared_ptr<Context> makeGlobalContext(
+      std::shared_ptr<const FrameLayout> layout);
 
  public:
-  explicit Program(std::istream &in, std::ostream &out) : in(in), out(out) {}
+  explicit Program(std::istream &in, std::ostream &out,
+                   Engine engine = Engine::TreeWalker)
+      : in(&in), out(out), engine(engine) {}
+  // Source is parsed in place, it has to outlive run()
+  Program(const char *begin, const char *end, std::ostream &out,
+          Engine engine = Engine::TreeWalker)
+      : sourceBegin(begin), sourceEnd(end), out(out), engine(engine) {}
+  // Changes made by the optimizer are reported to the log
+  void setOptimizerLog(std::ostream *log) { optimizerLog = log; }
+  // Functions with bodies up to the size are inlined, 0 disables inlining
+  void setInlineSize(std::size_t size) { inlineSize = size; }
+  void setMaxDepth(std::size_t depth) { maxDepth = depth; }
   void run();
 };
 
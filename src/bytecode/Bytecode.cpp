@@ -0,0 +1,131 @@
+// Copyright 2019 Kamil Mankowski
+
+#include "Bytecode.h"
+
+namespace bytecode {
+
+namespace {
+
+std::string codeToString(const Module &module, const std::vector<Op> &code) {
+  std::string out = "";
+  for (int i = 0; i < code.size(); ++i) {
+    auto &op = code[i];
+    out += "  " + std::to_string(i) + " " + opCodeToString(op.code);
+    switch (op.code) {
+      case OpCode::PushConst:
+        out += " " + module.constants[op.a]->toString();
+        break;
+      case OpCode::LoadName:
+      case OpCode::StoreName:
+      case OpCode::LoadFunction:
+      case OpCode::ForStart:
+        out += " " + module.names[op.a];
+        break;
+      case OpCode::LoadSlot:
+      case OpCode::LoadGlobal:
+      case OpCode::StoreSlot:
+      case OpCode::Unset:
+        out += " " + std::to_string(op.a) + " " + module.names[op.b];
+        break;
+      case OpCode::LoadBound:
+        out += " " + module.functions[op.a]->name + " " + std::to_string(op.b);
+        break;
+      case OpCode::ForNextSlot:
+      case OpCode::CompareJump:
+        out += " " + std::to_string(op.a) + " " + std::to_string(op.b);
+        break;
+      case OpCode::DefFunction:
+        out += " " + module.functions[op.a]->name;
+        break;
+      case OpCode::BuildList:
+      case OpCode::Slice:
+      case OpCode::Binary:
+      case OpCode::Compare:
+      case OpCode::Jump:
+      case OpCode::JumpIfFalse:
+      case OpCode::ForNext:
+      case OpCode::Call:
+      case OpCode::TailCall:
+      case OpCode::EvalNode:
+        out += " " + std::to_string(op.a);
+        break;
+      default:
+        break;
+    }
+    out += "\n";
+  }
+  return out;
+}
+
+}  // namespace
+
+std::string Module::toString() const {
+  std::string out = "main:\n" + codeToString(*this, code);
+  for (auto &function : functions) {
+    out += "def " + function->name + ":\n";
+    out += codeToString(*this, function->code);
+  }
+  return out;
+}
+
+std::string opCodeToString(OpCode code) {
+  switch (code) {
+    case OpCode::PushConst:
+      return "PushConst";
+    case OpCode::LoadName:
+      return "LoadName";
+    case OpCode::StoreName:
+      return "StoreName";
+    case OpCode::LoadSlot:
+      return "LoadSlot";
+    case OpCode::LoadGlobal:
+      return "LoadGlobal";
+    case OpCode::StoreSlot:
+      return "StoreSlot";
+    case OpCode::Pop:
+      return "Pop";
+    case OpCode::BuildList:
+      return "BuildList";
+    case OpCode::Slice:
+      return "Slice";
+    case OpCode::Binary:
+      return "Binary";
+    case OpCode::Compare:
+      return "Compare";
+    case OpCode::Jump:
+      return "Jump";
+    case OpCode::JumpIfFalse:
+      return "JumpIfFalse";
+    case OpCode::CompareJump:
+      return "CompareJump";
+    case OpCode::LoadFunction:
+      return "LoadFunction";
+    case OpCode::LoadBound:
+      return "LoadBound";
+    case OpCode::Call:
+      return "Call";
+    case OpCode::TailCall:
+      return "TailCall";
+    case OpCode::Return:
+      return "Return";
+    case OpCode::DefFunction:
+      return "DefFunction";
+    case OpCode::Unset:
+      return "Unset";
+    case OpCode::ForStart:
+      return "ForStart";
+    case OpCode::ForNext:
+      return "ForNext";
+    case OpCode::ForNextSlot:
+      return "ForNextSlot";
+    case OpCode::ForEnd:
+      return "ForEnd";
+    case OpCode::EvalNode:
+      return "EvalNode";
+    case OpCode::Halt:
+      return "Halt";
+  }
+  return "Unknown";
+}
+
+}  // namespace bytecode
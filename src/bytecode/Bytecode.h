@@ -0,0 +1,86 @@
+// Copyright 2019 Kamil Mankowski
+
+#ifndef SRC_BYTECODE_BYTECODE_H_
+#define SRC_BYTECODE_BYTECODE_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../execute/FrameLayout.h"
+#include "../execute/Instructions.h"
+#include "../execute/Value.h"
+
+namespace bytecode {
+
+enum class OpCode : std::uint8_t {
+  PushConst,     // a: constant index
+  LoadName,      // a: name index
+  StoreName,     // a: name index, pops the value
+  LoadSlot,      // a: frame slot, b: name index
+  LoadGlobal,    // a: global frame slot, b: name index
+  StoreSlot,     // a: frame slot, b: name index, pops the value
+  Pop,           //
+  BuildList,     // a: elements count
+  Slice,         // a: slice index
+  Binary,        // a: Expression::Type
+  Compare,       // a: CompareExpr::Type
+  Jump,          // a: target
+  JumpIfFalse,   // a: target, pops the condition
+  CompareJump,   // a: target when false, b: CompareExpr::Type, pops operands
+  LoadFunction,  // a: name index, b: 1 when LoadBound follows as fallback,
+                 // pushes callee
+  LoadBound,     // a: function index, b: scope depth, pushes callee
+  Call,          // a: arguments count, pops callee
+  TailCall,      // a: arguments count, pops callee, replaces the frame
+  Return,        // pops the result
+  DefFunction,   // a: function index
+  Unset,         // a: slot or -1, b: name index
+  ForStart,      // a: iterator name index, pops the iterable, pushes loop state
+  ForNext,       // a: exit target, pushes the next element
+  ForNextSlot,   // a: exit target, b: iterator slot
+  ForEnd,        // pops loop state
+  EvalNode,      // a: node index, evaluated by the tree walker
+  Halt
+};
+
+struct Op {
+  OpCode code;
+  std::int32_t a;
+  std::int32_t b;
+};
+
+struct SliceInfo {
+  Slice::SliceType type;
+  int start;
+  int end;
+  std::string sourceName;
+};
+
+struct FunctionProto {
+  std::string name;
+  std::vector<std::string> argumentNames;
+  std::vector<int> argumentSlots;
+  std::shared_ptr<const FrameLayout> layout;
+  std::vector<Op> code;
+};
+
+// Compiled program. Holds non-owning pointers to the AST nodes evaluated
+// with EvalNode, so the parsed code has to outlive it.
+struct Module {
+  std::vector<Op> code;
+  std::vector<std::unique_ptr<FunctionProto>> functions;
+  std::vector<std::shared_ptr<Value>> constants;
+  std::vector<std::string> names;
+  std::vector<SliceInfo> slices;
+  std::vector<Instruction *> nodes;
+
+  std::string toString() const;
+};
+
+std::string opCodeToString(OpCode code);
+
+}  // namespace bytecode
+
+#endif  // SRC_BYTECODE_BYTECODE_H_
@@ -0,0 +1,136 @@
+// Copyright 2019 Kamil Mankowski
+
+#include "Compiler.h"
+
+#include "VirtualMachine.h"
+
+namespace bytecode {
+
+std::unique_ptr<Module> Compiler::compile(CodeBlock &code) {
+  module = std::make_unique<Module>();
+  namesIndex.clear();
+  functionsIndex.clear();
+  targets.clear();
+  targets.push_back(Target{&module->code, nullptr, {}});
+
+  code.compileStatement(*this);
+  emit(OpCode::Halt);
+
+  targets.clear();
+  return std::move(module);
+}
+
+void Compiler::emit(OpCode code, std::int32_t a, std::int32_t b) {
+  current().code->push_back(Op{code, a, b});
+}
+
+std::int32_t Compiler::position() const { return targets.back().code->size(); }
+
+std::int32_t Compiler::emitJump(OpCode code, std::int32_t b) {
+  auto jumpPosition = position();
+  emit(code, -1, b);
+  return jumpPosition;
+}
+
+void Compiler::patchJump(std::int32_t jumpPosition) {
+  (*current().code)[jumpPosition].a = position();
+}
+
+std::int32_t Compiler::addConstant(std::shared_ptr<Value> value) {
+  module->constants.push_back(value);
+  return module->constants.size() - 1;
+}
+
+std::int32_t Compiler::addName(const std::string &name) {
+  auto found = namesIndex.find(name);
+  if (found != namesIndex.end()) return found->second;
+
+  module->names.push_back(name);
+  std::int32_t index = module->names.size() - 1;
+  namesIndex[name] = index;
+  return index;
+}
+
+std::int32_t Compiler::addSlice(SliceInfo slice) {
+  module->slices.push_back(slice);
+  return module->slices.size() - 1;
+}
+
+std::int32_t Compiler::addNode(Instruction *node) {
+  module->nodes.push_back(node);
+  return module->nodes.size() - 1;
+}
+
+void Compiler::emitLoad(const VariableRef &ref, const std::string &name) {
+  if (ref.slot >= 0 && ref.depth == 0)
+    emit(OpCode::LoadSlot, ref.slot, addName(name));
+  else if (ref.slot >= 0 && ref.depth == VariableRef::Global)
+    emit(OpCode::LoadGlobal, ref.slot, addName(name));
+  else
+    emit(OpCode::LoadName, addName(name));
+}
+
+void Compiler::emitStore(int slot, const std::string &name) {
+  if (slot < 0)
+    emit(OpCode::StoreName, addName(name));
+  else
+    emit(OpCode::StoreSlot, slot, addName(name));
+}
+
+std::int32_t Compiler::beginFunction(
+    const std::string &name, const std::vector<std::string> &argumentNames,
+    std::shared_ptr<const FrameLayout> layout,
+    const std::vector<int> &argumentSlots, const Instruction *definition) {
+  std::int32_t index;
+  if (definition != nullptr) {
+    index = functionIndex(definition);
+  } else {
+    module->functions.push_back(std::make_unique<FunctionProto>());
+    index = module->functions.size() - 1;
+  }
+
+  auto &proto = module->functions[index];
+  proto->name = name;
+  proto->argumentNames = argumentNames;
+  proto->argumentSlots = argumentSlots;
+  proto->layout = layout;
+  targets.push_back(Target{&proto->code, proto.get(), {}});
+  return index;
+}
+
+void Compiler::endFunction() {
+  emit(OpCode::PushConst, addConstant(Value::makeNone()));
+  emit(OpCode::Return);
+  targets.pop_back();
+}
+
+std::int32_t Compiler::functionIndex(const Instruction *definition) {
+  auto found = functionsIndex.find(definition);
+  if (found != functionsIndex.end()) return found->second;
+
+  module->functions.push_back(std::make_unique<FunctionProto>());
+  std::int32_t index = module->functions.size() - 1;
+  functionsIndex[definition] = index;
+  return index;
+}
+
+void Compiler::beginLoop(std::int32_t continueTarget) {
+  current().loops.push_back(Loop{continueTarget, {}});
+}
+
+void Compiler::endLoop() {
+  for (auto jumpPosition : current().loops.back().breakJumps)
+    patchJump(jumpPosition);
+  current().loops.pop_back();
+}
+
+void Compiler::emitBreak() {
+  auto jumpPosition = emitJump(OpCode::Jump);
+  current().loops.back().breakJumps.push_back(jumpPosition);
+}
+
+void Compiler::emitContinue() {
+  emit(OpCode::Jump, current().loops.back().continueTarget);
+}
+
+}  // namespace bytecode
@@ -0,0 +1,73 @@
+// Copyright 2019 Kamil Mankowski
+
+#ifndef SRC_BYTECODE_COMPILER_H_
+#define SRC_BYTECODE_COMPILER_H_
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../execute/Instructions.h"
+#include "Bytecode.h"
+
+namespace bytecode {
+
+class Compiler {
+ public:
+  std::unique_ptr<Module> compile(CodeBlock &code);
+
+  void emit(OpCode code, std::int32_t a = 0, std::int32_t b = 0);
+  std::int32_t position() const;
+  // Emits jump with unknown target, returns position to patch later
+  std::int32_t emitJump(OpCode code, std::int32_t b = 0);
+  void patchJump(std::int32_t jumpPosition);
+
+  std::int32_t addConstant(std::shared_ptr<Value> value);
+  std::int32_t addName(const std::string &name);
+  std::int32_t addSlice(SliceInfo slice);
+  std::int32_t addNode(Instruction *node);
+
+  // Variable access by frame slot, or by name when it was not resolved.
+  // Variables of enclosing functions (not global) are loaded by name.
+  void emitLoad(const VariableRef &ref, const std::string &name);
+  void emitStore(int slot, const std::string &name);
+
+  // Function compiled for the definition node, it can be referenced by
+  // functionIndex() before it is compiled
+  std::int32_t beginFunction(const std::string &name,
+                             const std::vector<std::string> &argumentNames,
+                             std::shared_ptr<const FrameLayout> layout,
+                             const std::vector<int> &argumentSlots,
+                             const Instruction *definition = nullptr);
+  void endFunction();
+  std::int32_t functionIndex(const Instruction *definition);
+
+  void beginLoop(std::int32_t continueTarget);
+  void endLoop();
+  void emitBreak();
+  void emitContinue();
+
+ private:
+  struct Loop {
+    std::int32_t continueTarget;
+    std::vector<std::int32_t> breakJumps;
+  };
+  struct Target {
+    std::vector<Op> *code;
+    FunctionProto *function;
+    std::vector<Loop> loops;
+  };
+
+  std::unique_ptr<Module> module;
+  std::vector<Target> targets;
+  std::map<std::string, std::int32_t> namesIndex;
+  std::map<const Instruction *, std::int32_t> functionsIndex;
+
+  Target &current() { return targets.back(); }
+};
+
+}  // namespace bytecode
+
+#endif  // SRC_BYTECODE_COMPILER_H_
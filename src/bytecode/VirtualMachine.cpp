@@ -0,0 +1,323 @@
+// Copyright 2019 Kamil Mankowski
+
+#include "VirtualMachine.h"
+
+namespace bytecode {
+
+namespace {
+
+// Fast paths for the most common operands, the rest goes through the same
+// generic helpers as tree walker.
+inline std::int64_t intOperation(std::int64_t left, std::int64_t right,
+                                 Expression::Type type) {
+  if (type == Expression::Add) return left + right;
+  if (type == Expression::Sub) return left - right;
+  return left * right;
+}
+
+inline bool intCompare(std::int64_t left, std::int64_t right,
+                       CompareExpr::Type type) {
+  switch (type) {
+    case CompareExpr::Greater:
+      return left > right;
+    case CompareExpr::GreaterEq:
+      return left >= right;
+    case CompareExpr::Less:
+      return left < right;
+    case CompareExpr::LessEq:
+      return left <= right;
+    case CompareExpr::Different:
+      return left != right;
+    default:
+      return left == right;
+  }
+}
+
+}  // namespace
+
+void VirtualMachine::run(std::shared_ptr<Context> ctx) {
+  auto baseDepth = frames.size();
+  frames.push_back(Frame{module.code.data(), module.code.data(), ctx,
+                         loops.size()});
+  execute(baseDepth);
+}
+
+std::shared_ptr<Value> VirtualMachine::call(const FunctionProto &function,
+                                            std::shared_ptr<Context> ctx) {
+  auto baseDepth = frames.size();
+  pushFunctionFrame(function, ctx);
+  return execute(baseDepth);
+}
+
+void VirtualMachine::pushFunctionFrame(const FunctionProto &function,
+                                       std::shared_ptr<Context> ctx) {
+  if (calls >= maxDepth) throw RecursionTooDeep(maxDepth);
+  auto &argumentNames = function.argumentNames;
+  if (ctx->parametersSize() != argumentNames.size())
+    throw ParametersCountNotExpected(function.name, ctx->parametersSize(),
+                                     argumentNames.size());
+  ctx->setLayout(function.layout);
+  for (int i = 0; i < argumentNames.size(); ++i) {
+    auto &slots = function.argumentSlots;
+    int slot = i < slots.size() ? slots[i] : -1;
+    ctx->setVariable(slot, argumentNames[i], ctx->getParameter(i));
+  }
+
+  frames.push_back(Frame{function.code.data(), function.code.data(), ctx,
+                         loops.size()});
+  ++calls;
+}
+
+std::shared_ptr<Value> VirtualMachine::pop() {
+  auto value = std::move(stack.back());
+  stack.pop_back();
+  return value;
+}
+
+std::shared_ptr<Value> VirtualMachine::execute(std::size_t baseDepth) {
+  Frame *frame = &frames.back();
+  const Op *pc = frame->pc;
+
+  while (true) {
+    const Op &op = *pc++;
+    switch (op.code) {
+      case OpCode::PushConst:
+        stack.push_back(module.constants[op.a]);
+        break;
+
+      case OpCode::LoadName: {
+        auto &name = module.names[op.a];
+        auto value = frame->ctx->getVariableValue(name);
+        if (value == nullptr) throw ReadNotAssignVariable(name);
+        stack.push_back(std::move(value));
+        break;
+      }
+
+      case OpCode::StoreName:
+        frame->ctx->setVariable(module.names[op.a], pop());
+        break;
+
+      case OpCode::LoadSlot: {
+        auto value = frame->ctx->getVariableValue(op.a, module.names[op.b]);
+        if (value == nullptr) throw ReadNotAssignVariable(module.names[op.b]);
+        stack.push_back(std::move(value));
+        break;
+      }
+
+      case OpCode::LoadGlobal: {
+        auto &name = module.names[op.b];
+        auto value = frame->ctx->getVariableValue(
+            VariableRef{VariableRef::Global, op.a}, name);
+        if (value == nullptr) throw ReadNotAssignVariable(name);
+        stack.push_back(std::move(value));
+        break;
+      }
+
+      case OpCode::StoreSlot:
+        frame->ctx->setVariable(op.a, module.names[op.b], pop());
+        break;
+
+      case OpCode::Unset:
+        frame->ctx->setVariable(op.a, module.names[op.b], nullptr);
+        break;
+
+      case OpCode::Pop:
+        stack.pop_back();
+        break;
+
+      case OpCode::BuildList: {
+        std::vector<std::shared_ptr<Value>> elements(stack.end() - op.a,
+                                                     stack.end());
+        stack.resize(stack.size() - op.a);
+        stack.push_back(std::make_shared<Value>(std::move(elements)));
+        break;
+      }
+
+      case OpCode::Slice: {
+        auto &info = module.slices[op.a];
+        stack.back() = Slice::slice(stack.back(), info.type, info.start,
+                                    info.end, info.sourceName);
+        break;
+      }
+
+      case OpCode::Binary: {
+        auto right = pop();
+        auto &left = stack.back();
+        auto type = static_cast<Expression::Type>(op.a);
+        if (left->getType() == ValueType::Int &&
+            right->getType() == ValueType::Int && type != Expression::Div &&
+            type != Expression::Exp)
+          left = Value::makeInt(
+              intOperation(left->getInt(), right->getInt(), type));
+        else
+          left = Expression::evaluate(left, right, type);
+        break;
+      }
+
+      case OpCode::Compare: {
+        auto right = pop();
+        auto &left = stack.back();
+        auto type = static_cast<CompareExpr::Type>(op.a);
+        if (left->getType() == ValueType::Int &&
+            right->getType() == ValueType::Int)
+          left = Value::makeBool(
+              intCompare(left->getInt(), right->getInt(), type));
+        else
+          left = Value::makeBool(CompareExpr::evaluate(left, right, type));
+        break;
+      }
+
+      case OpCode::Jump:
+        pc = frame->code + op.a;
+        break;
+
+      case OpCode::JumpIfFalse:
+        if (CompareExpr::isFalseEquivalent(pop())) pc = frame->code + op.a;
+        break;
+
+      case OpCode::CompareJump: {
+        auto right = pop();
+        auto left = pop();
+        auto type = static_cast<CompareExpr::Type>(op.b);
+        bool result;
+        if (left->getType() == ValueType::Int &&
+            right->getType() == ValueType::Int)
+          result = intCompare(left->getInt(), right->getInt(), type);
+        else
+          result = CompareExpr::evaluate(left, right, type);
+        if (!result) pc = frame->code + op.a;
+        break;
+      }
+
+      case OpCode::LoadFunction: {
+        auto &name = module.names[op.a];
+        auto func = frame->ctx->getFunction(name);
+        if (func == nullptr && op.b) break;
+        if (func == nullptr) throw FunctionNotDeclared(name);
+        if (op.b) ++pc;
+        auto compiled = dynamic_cast<BytecodeFunction *>(func.get());
+        if (compiled != nullptr)
+          callees.push_back(
+              Callee{nullptr, &compiled->getFunction(), compiled->getScope()});
+        else
+          callees.push_back(Callee{std::move(func), nullptr, frame->ctx});
+        break;
+      }
+
+      case OpCode::LoadBound:
+        callees.push_back(Callee{nullptr, module.functions[op.a].get(),
+                                 Context::enclosing(frame->ctx, op.b)});
+        break;
+
+      case OpCode::Call:
+      case OpCode::TailCall: {
+        auto callee = std::move(callees.back());
+        callees.pop_back();
+
+        auto callctx = std::make_shared<Context>(std::move(callee.scope));
+        for (auto arg = stack.end() - op.a; arg != stack.end(); ++arg)
+          callctx->addParameter(std::move(*arg));
+        stack.resize(stack.size() - op.a);
+
+        if (callee.proto == nullptr) {
+          stack.push_back(callee.function->exec(callctx));
+          break;
+        }
+
+        // Call in tail position replaces the frame of the caller, so the
+        // callee returns straight to the caller's caller
+        if (op.code == OpCode::TailCall) {
+          loops.resize(frame->loopsBase);
+          frames.pop_back();
+          --calls;
+        } else {
+          frame->pc = pc;
+        }
+        pushFunctionFrame(*callee.proto, callctx);
+        frame = &frames.back();
+        pc = frame->pc;
+        break;
+      }
+
+      case OpCode::Return: {
+        auto result = pop();
+        loops.resize(frame->loopsBase);
+        frames.pop_back();
+        --calls;
+        if (frames.size() == baseDepth) return result;
+
+        stack.push_back(std::move(result));
+        frame = &frames.back();
+        pc = frame->pc;
+        break;
+      }
+
+      case OpCode::DefFunction: {
+        auto &function = *module.functions[op.a];
+        auto defined = dynamic_cast<BytecodeFunction *>(
+            frame->ctx->getOwnFunction(function.name).get());
+        if (defined != nullptr && &defined->getFunction() == &function) break;
+        frame->ctx->setFunction(
+            function.name,
+            std::make_shared<BytecodeFunction>(module, function, frame->ctx,
+                                               maxDepth));
+        break;
+      }
+
+      case OpCode::ForStart: {
+        auto iterable = pop();
+        if (iterable->getType() != ValueType::List) throw IterableExpected();
+        auto size = iterable->size();
+        loops.push_back(Loop{std::move(iterable), size, 0, op.a, nullptr});
+        break;
+      }
+
+      case OpCode::ForNext: {
+        auto &loop = loops.back();
+        if (loop.index == loop.size) {
+          pc = frame->code + op.a;
+          break;
+        }
+        stack.push_back(loop.iterable->getElement(loop.index++));
+        break;
+      }
+
+      case OpCode::ForNextSlot: {
+        auto &loop = loops.back();
+        if (loop.index == loop.size) {
+          pc = frame->code + op.a;
+          break;
+        }
+        auto &name = module.names[loop.name];
+        if (loop.iterable->isRange())
+          frame->ctx->setCounter(op.b, name, loop.counter,
+                                 loop.iterable->getRange().at(loop.index++));
+        else
+          frame->ctx->setVariable(op.b, name,
+                                  loop.iterable->getElement(loop.index++));
+        break;
+      }
+
+      case OpCode::ForEnd:
+        loops.pop_back();
+        break;
+
+      case OpCode::EvalNode:
+        stack.push_back(module.nodes[op.a]->exec(frame->ctx));
+        break;
+
+      case OpCode::Halt:
+        frames.pop_back();
+        return nullptr;
+    }
+  }
+}
+
+std::shared_ptr<Value> BytecodeFunction::exec(std::shared_ptr<Context> ctx) {
+  auto definitionCtx = scope.lock();
+  if (definitionCtx != nullptr) ctx->setParent(definitionCtx);
+  VirtualMachine vm(module, maxDepth);
+  return vm.call(function, ctx);
+}
+
+}  // namespace bytecode
@@ -0,0 +1,100 @@
+// Copyright 2019 Kamil Mankowski
+
+#ifndef SRC_BYTECODE_VIRTUALMACHINE_H_
+#define SRC_BYTECODE_VIRTUALMACHINE_H_
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../execute/Context.h"
+#include "../execute/Instructions.h"
+#include "Bytecode.h"
+
+namespace bytecode {
+
+// Stack based interpreter of compiled module. Variables and functions are
+// kept in the same Context objects as in tree walker, so builtins and
+// contexts prepared by Program work without changes. Script calls are pushed
+// on the frames stack instead of recursing, so the depth of recursion is
+// limited only by maxDepth.
+class VirtualMachine {
+ public:
+  static constexpr std::size_t defaultMaxDepth = 10000000;
+
+  explicit VirtualMachine(const Module &module,
+                          std::size_t maxDepth = defaultMaxDepth)
+      : module(module), maxDepth(maxDepth) {}
+
+  void run(std::shared_ptr<Context> ctx);
+  std::shared_ptr<Value> call(const FunctionProto &function,
+                              std::shared_ptr<Context> ctx);
+
+ private:
+  struct Frame {
+    const Op *code;
+    const Op *pc;
+    std::shared_ptr<Context> ctx;
+    std::size_t loopsBase;
+  };
+  // Iterates elements of the list in place, iterable keeps them alive.
+  // Over range() the iterator value is reused, see Context::setCounter.
+  struct Loop {
+    std::shared_ptr<Value> iterable;
+    std::size_t size;
+    std::size_t index;
+    std::int32_t name;
+    std::shared_ptr<Value> counter;
+  };
+
+  // Function to call with the context its frame is created in. Proto is
+  // nullptr for functions which are not compiled (builtins).
+  struct Callee {
+    std::shared_ptr<Instruction> function;
+    const FunctionProto *proto;
+    std::shared_ptr<Context> scope;
+  };
+
+  const Module &module;
+  std::size_t maxDepth;
+  // Function frames on the stack, the frame of the module is not counted
+  std::size_t calls = 0;
+  std::vector<std::shared_ptr<Value>> stack;
+  std::vector<Callee> callees;
+  std::vector<Loop> loops;
+  std::vector<Frame> frames;
+
+  void pushFunctionFrame(const FunctionProto &function,
+                         std::shared_ptr<Context> ctx);
+  std::shared_ptr<Value> execute(std::size_t baseDepth);
+  std::shared_ptr<Value> pop();
+};
+
+// Script function compiled to bytecode, registered in context as any other
+// function. Called outside of VM (e.g. from tree walker) it runs own VM.
+class BytecodeFunction : public Instruction {
+ public:
+  BytecodeFunction(const Module &module, const FunctionProto &function,
+                   std::shared_ptr<Context> scope,
+                   std::size_t maxDepth = VirtualMachine::defaultMaxDepth)
+      : module(module), function(function), scope(scope),
+        maxDepth(maxDepth) {}
+
+  std::string instrName() override { return function.name; }
+  std::shared_ptr<Value> exec(std::shared_ptr<Context> ctx) override;
+  const FunctionProto &getFunction() const { return function; }
+  std::shared_ptr<Context> getScope() const { return scope.lock(); }
+
+ private:
+  const Module &module;
+  const FunctionProto &function;
+  // Context of the definition, weak because the context owns the function
+  std::weak_ptr<Context> scope;
+  // Limit of the VM which has defined the function
+  std::size_t maxDepth;
+};
+
+}  // namespace bytecode
+
+#endif  // SRC_BYTECODE_VIRTUALMACHINE_H_
@@ -0,0 +1,489 @@
+// Copyright 2019 Kamil Mankowski
+
+#include <algorithm>
+#include <sstream>
+
+#include <boost/test/unit_test.hpp>
+
+#include "../../Program.h"
+#include "../Compiler.h"
+#include "../VirtualMachine.h"
+
+BOOST_AUTO_TEST_SUITE(VirtualMachineTest)
+
+std::string run_program(const std::string &code, Program::Engine engine) {
+  std::stringstream input(code);
+  std::stringstream output;
+  Program program(input, output, engine);
+  program.run();
+  return output.str();
+}
+
+void assert_same_output(const std::string &code, const std::string &expected) {
+  BOOST_TEST(run_program(code, Program::Engine::TreeWalker) == expected);
+  BOOST_TEST(run_program(code, Program::Engine::Bytecode) == expected);
+}
+
+std::unique_ptr<bytecode::Module> compile(const std::string &code,
+                                          std::unique_ptr<CodeBlock> &parsed) {
+  std::stringstream input(code);
+  Parser parser(input);
+  parsed = parser.parse();
+  bytecode::Compiler compiler;
+  return compiler.compile(*parsed);
+}
+
+BOOST_AUTO_TEST_CASE(test_compile_assign) {
+  std::unique_ptr<CodeBlock> parsed;
+  auto module = compile("a = 3\nb = a + 4", parsed);
+
+  std::string expected =
+      "main:\n"
+      "  0 PushConst 3\n"
+      "  1 StoreName a\n"
+      "  2 LoadName a\n"
+      "  3 PushConst 4\n"
+      "  4 Binary 1\n"
+      "  5 StoreName b\n"
+      "  6 Halt\n";
+  BOOST_TEST(module->toString() == expected);
+}
+
+BOOST_AUTO_TEST_CASE(test_compile_resolved_slots) {
+  std::stringstream input("a = 3\nfor i in a:\n  a += i");
+  Parser parser(input);
+  auto parsed = parser.parse();
+  FrameLayout layout;
+  parsed->resolveScope(layout);
+  bytecode::Compiler compiler;
+  auto module = compiler.compile(*parsed);
+
+  std::string expected =
+      "main:\n"
+      "  0 PushConst 3\n"
+      "  1 StoreSlot 0 a\n"
+      "  2 LoadSlot 0 a\n"
+      "  3 ForStart i\n"
+      "  4 ForNextSlot 10 1\n"
+      "  5 LoadSlot 0 a\n"
+      "  6 LoadSlot 1 i\n"
+      "  7 Binary 1\n"
+      "  8 StoreSlot 0 a\n"
+      "  9 Jump 4\n"
+      "  10 ForEnd\n"
+      "  11 Halt\n";
+  BOOST_TEST(module->toString() == expected);
+}
+
+BOOST_AUTO_TEST_CASE(test_compile_fused_condition) {
+  std::unique_ptr<CodeBlock> parsed;
+  auto module = compile("while a < 3:\n  a += 1\nif a:\n  a = 0", parsed);
+
+  std::string expected =
+      "main:\n"
+      "  0 LoadName a\n"
+      "  1 PushConst 3\n"
+      "  2 CompareJump 8 3\n"
+      "  3 LoadName a\n"
+      "  4 PushConst 1\n"
+      "  5 Binary 1\n"
+      "  6 StoreName a\n"
+      "  7 Jump 0\n"
+      "  8 LoadName a\n"
+      "  9 JumpIfFalse 12\n"
+      "  10 PushConst 0\n"
+      "  11 StoreName a\n"
+      "  12 Halt\n";
+  BOOST_TEST(module->toString() == expected);
+}
+
+BOOST_AUTO_TEST_CASE(test_compile_function) {
+  std::unique_ptr<CodeBlock> parsed;
+  auto module = compile("def f(x):\n  return x\nf(1)", parsed);
+
+  BOOST_TEST(module->functions.size() == 1);
+  BOOST_TEST(module->functions[0]->name == "f");
+  BOOST_TEST(module->functions[0]->argumentNames.size() == 1);
+  auto &code = module->functions[0]->code;
+  BOOST_TEST((code.back().code == bytecode::OpCode::Return));
+}
+
+BOOST_AUTO_TEST_CASE(test_compile_bound_function) {
+  std::stringstream input("def f(x):\n  return x\nf(1)");
+  Parser parser(input);
+  auto parsed = parser.parse();
+  FrameLayout layout;
+  parsed->resolveScope(layout);
+  bytecode::Compiler compiler;
+  auto module = compiler.compile(*parsed);
+
+  std::string expected =
+      "main:\n"
+      "  0 LoadBound f 0\n"
+      "  1 PushConst 1\n"
+      "  2 Call 1\n"
+      "  3 Pop\n"
+      "  4 Halt\n"
+      "def f:\n"
+      "  0 LoadSlot 0 x\n"
+      "  1 Return\n"
+      "  2 PushConst None\n"
+      "  3 Return\n";
+  BOOST_TEST(module->toString() == expected);
+}
+
+BOOST_AUTO_TEST_CASE(test_run_loops) {
+  std::string code =
+      "s = 0\n"
+      "for i in range(10):\n"
+      "  if i == 2:\n"
+      "    continue\n"
+      "  if i == 6:\n"
+      "    break\n"
+      "  s += i\n"
+      "while s > 3:\n"
+      "  s -= 3\n"
+      "  if s == 5:\n"
+      "    break\n"
+      "print(s, i)";
+  assert_same_output(code, "1 6 \n");
+}
+
+BOOST_AUTO_TEST_CASE(test_run_recursion) {
+  std::string code =
+      "def fib(n):\n"
+      "  if n < 2:\n"
+      "    return n\n"
+      "  return fib(n - 1) + fib(n - 2)\n"
+      "print(fib(15))";
+  assert_same_output(code, "610 \n");
+}
+
+BOOST_AUTO_TEST_CASE(test_run_tail_recursion) {
+  std::string code =
+      "def count(n, acc):\n"
+      "  if n == 0:\n"
+      "    return acc\n"
+      "  return count(n - 1, acc + n)\n"
+      "print(count(200000, 0))";
+  assert_same_output(code, "20000100000 \n");
+}
+
+BOOST_AUTO_TEST_CASE(test_run_tail_calls) {
+  std::string code =
+      "def last(x):\n"
+      "  return x[1]\n"
+      "def size(x):\n"
+      "  return len(x)\n"
+      "def both(x):\n"
+      "  return last(x)\n"
+      "def f(n):\n"
+      "  a = n\n"
+      "  if n > 0:\n"
+      "    return f(n - 1)\n"
+      "  return a\n"
+      "print(size([1, 2]), both([3, 4]), f(3))";
+  assert_same_output(code, "2 4 0 \n");
+}
+
+BOOST_AUTO_TEST_CASE(test_run_return_from_loop) {
+  std::string code =
+      "def find(list, value):\n"
+      "  for e in list:\n"
+      "    for f in list:\n"
+      "      if e + f == value:\n"
+      "        return [e, f]\n"
+      "print(find([1, 2, 3], 5), find([1], 5))";
+  assert_same_output(code, "[2, 3] None \n");
+}
+
+BOOST_AUTO_TEST_CASE(test_run_nested_function) {
+  std::string code =
+      "def outer(a):\n"
+      "  def inner(b):\n"
+      "    return b * 2\n"
+      "  return inner(a) + 1\n"
+      "print(outer(4), outer(2.5))";
+  assert_same_output(code, "9 6.000000 \n");
+}
+
+BOOST_AUTO_TEST_CASE(test_run_bound_functions) {
+  std::string code =
+      "for i in range(3):\n"
+      "  def square(x):\n"
+      "    return x * x\n"
+      "  print(square(i))\n"
+      "def outer(n):\n"
+      "  def inner(k):\n"
+      "    if k > 0:\n"
+      "      return inner(k - 1)\n"
+      "    return n\n"
+      "  return inner(3)\n"
+      "print(outer(7), outer(9))";
+  assert_same_output(code, "0 \n1 \n4 \n7 9 \n");
+}
+
+BOOST_AUTO_TEST_CASE(test_run_conditional_definition_not_bound) {
+  std::string code =
+      "def f():\n"
+      "  return 1\n"
+      "def g(x):\n"
+      "  if x:\n"
+      "    def f():\n"
+      "      return 2\n"
+      "  return f()\n"
+      "print(g(0), g(1))";
+  assert_same_output(code, "1 2 \n");
+}
+
+BOOST_AUTO_TEST_CASE(test_run_conditional_definition_not_executed) {
+  std::stringstream input("x = 0\nif x:\n  def h():\n    return 5\ny = h()");
+  Parser parser(input);
+  auto parsed = parser.parse();
+  auto layout = std::make_shared<FrameLayout>();
+  parsed->resolveScope(*layout);
+
+  auto ctx = std::make_shared<Context>();
+  ctx->setLayout(layout);
+  BOOST_CHECK_THROW(parsed->execStatement(ctx), FunctionNotDeclared);
+
+  bytecode::Compiler compiler;
+  auto module = compiler.compile(*parsed);
+  bytecode::VirtualMachine vm(*module);
+  ctx = std::make_shared<Context>();
+  ctx->setLayout(layout);
+  BOOST_CHECK_THROW(vm.run(ctx), FunctionNotDeclared);
+}
+
+BOOST_AUTO_TEST_CASE(test_run_lexical_scope) {
+  std::string code =
+      "depth = 0\n"
+      "def show():\n"
+      "  return depth\n"
+      "def down(n):\n"
+      "  depth = n + 1\n"
+      "  if n == 0:\n"
+      "    return show()\n"
+      "  return down(n - 1)\n"
+      "print(down(50))";
+  assert_same_output(code, "0 \n");
+}
+
+BOOST_AUTO_TEST_CASE(test_run_enclosing_function_variable) {
+  std::string code =
+      "def outer(a):\n"
+      "  b = a * 2\n"
+      "  def inner(c):\n"
+      "    return b + c + g\n"
+      "  return inner(1)\n"
+      "g = 100\n"
+      "print(outer(3))";
+  assert_same_output(code, "107 \n");
+}
+
+BOOST_AUTO_TEST_CASE(test_run_lazy_range) {
+  std::string code =
+      "r = range(1, 10, 2)\n"
+      "s = 0\n"
+      "for i in r:\n"
+      "  s += i\n"
+      "print(s, len(range(1000000000)), r[1:3], r[4])\n"
+      "if r == [1, 3, 5, 7, 9]:\n"
+      "  print(1)\n"
+      "if r[1:] == range(3, 11, 2):\n"
+      "  print(2)\n"
+      "if r > [0, 2, 4, 6, 8]:\n"
+      "  print(3)";
+  assert_same_output(code, "25 1000000000 [3, 5] 9 \n1 \n2 \n3 \n");
+}
+
+BOOST_AUTO_TEST_CASE(test_run_counted_loop_keeps_iterator_values) {
+  std::string code =
+      "l = []\n"
+      "for i in range(4):\n"
+      "  l = l + [i]\n"
+      "  last = i\n"
+      "  i = 10\n"
+      "print(l, last, i)";
+  assert_same_output(code, "[0, 1, 2, 3] 3 10 \n");
+}
+
+template <typename ExpectedException>
+void assert_vm_throws(const std::string &code) {
+  std::unique_ptr<CodeBlock> parsed;
+  auto module = compile(code, parsed);
+  bytecode::VirtualMachine vm(*module);
+  BOOST_CHECK_THROW(vm.run(std::make_shared<Context>()), ExpectedException);
+}
+
+BOOST_AUTO_TEST_CASE(test_run_inlined_calls) {
+  std::string code =
+      "def add(a, b):\n"
+      "  c = a + b\n"
+      "  return c * 2\n"
+      "def g(c):\n"
+      "  return add(c, 1) - c\n"
+      "a = 7\n"
+      "print(add(1, add(a, 3)), g(5), a)";
+  assert_same_output(code, "42 7 7 \n");
+}
+
+BOOST_AUTO_TEST_CASE(test_run_inlined_calls_unset_variables) {
+  std::string code =
+      "def plus_two(inp):\n"
+      "  inp += 2\n"
+      "  return inp\n"
+      "def f(x):\n"
+      "  y = x * 2\n"
+      "  return y\n"
+      "a = plus_two(1) + f(3)";
+  std::stringstream input(code);
+  Parser parser(input);
+  auto parsed = parser.parse();
+  Optimizer optimizer(nullptr, Optimizer::defaultInlineSize);
+  optimizer.optimize(*parsed);
+  auto inlined = parsed->toString();
+  BOOST_TEST(inlined.find("{plus_two.inp = 1") != std::string::npos);
+  BOOST_TEST(inlined.find("{f.x = 3") != std::string::npos);
+  auto layout = std::make_shared<FrameLayout>();
+  parsed->resolveScope(*layout);
+  bytecode::Compiler compiler;
+  auto module = compiler.compile(*parsed);
+
+  auto check = [](std::shared_ptr<Context> ctx) {
+    BOOST_TEST(ctx->getVariableValue("a")->getInt() == 9);
+    BOOST_TEST(ctx->getVariableValue("plus_two.inp") == nullptr);
+    BOOST_TEST(ctx->getVariableValue("f.x") == nullptr);
+    BOOST_TEST(ctx->getVariableValue("f.y") == nullptr);
+  };
+  auto ctx = std::make_shared<Context>();
+  ctx->setLayout(layout);
+  parsed->execStatement(ctx);
+  check(ctx);
+
+  ctx = std::make_shared<Context>();
+  ctx->setLayout(layout);
+  bytecode::VirtualMachine vm(*module);
+  vm.run(ctx);
+  check(ctx);
+}
+
+BOOST_AUTO_TEST_CASE(test_run_errors) {
+  assert_vm_throws<FunctionNotDeclared>("x = 1\nx = fail(x)");
+  assert_vm_throws<ReadNotAssignVariable>("x = y");
+  assert_vm_throws<ParametersCountNotExpected>("def f(a):\n  return a\nf()");
+  assert_vm_throws<OutOfRange>("x = [1][3]");
+  assert_vm_throws<IterableExpected>("x = 3\nfor i in x:\n  i = 1");
+  assert_vm_throws<OperandsTypesNotCompatible>("x = 3 + \"a\"");
+}
+
+BOOST_AUTO_TEST_CASE(test_run_recursion_limit) {
+  std::string code =
+      "def f(n):\n"
+      "  if n == 0:\n"
+      "    return 0\n"
+      "  return f(n - 1) + 1\n"
+      "def tail(n):\n"
+      "  if n == 0:\n"
+      "    return 0\n"
+      "  return tail(n - 1)\n"
+      "tail(1000)\n"
+      "f(limit)";
+  std::stringstream input(code);
+  Parser parser(input);
+  auto parsed = parser.parse();
+  auto layout = std::make_shared<FrameLayout>();
+  parsed->resolveScope(*layout);
+  bytecode::Compiler compiler;
+  auto module = compiler.compile(*parsed);
+  bytecode::VirtualMachine vm(*module, 100);
+
+  auto context = [&](std::int64_t limit) {
+    auto ctx = std::make_shared<Context>();
+    ctx->setLayout(layout);
+    ctx->setVariable("limit", Value::makeInt(limit));
+    ctx->setMaxCallDepth(100);
+    return ctx;
+  };
+  BOOST_CHECK_NO_THROW(vm.run(context(99)));
+  BOOST_CHECK_THROW(vm.run(context(100)), RecursionTooDeep);
+  BOOST_CHECK_NO_THROW(parsed->execStatement(context(99)));
+  BOOST_CHECK_THROW(parsed->execStatement(context(100)), RecursionTooDeep);
+
+  // Called outside of the module, the function runs own VM with the limit
+  // of the one which has defined it
+  auto &proto = **std::find_if(
+      module->functions.begin(), module->functions.end(),
+      [](const std::unique_ptr<bytecode::FunctionProto> &function) {
+        return function->name == "f";
+      });
+  auto call = [&](std::int64_t n) {
+    auto ctx = context(0);
+    bytecode::BytecodeFunction function(*module, proto, ctx, 100);
+    auto callctx = std::make_shared<Context>(ctx);
+    callctx->addParameter(Value::makeInt(n));
+    return function.exec(callctx);
+  };
+  BOOST_CHECK_NO_THROW(call(99));
+  BOOST_CHECK_THROW(call(100), RecursionTooDeep);
+}
+
+// Each call goes through the blocks on the native stack, the tree walker
+// stops before the stack runs out, unless the maximum depth is reached first
+BOOST_AUTO_TEST_CASE(test_run_recursion_nested_blocks) {
+  std::string code =
+      "def f(n):\n"
+      "  while 1:\n"
+      "    for i in [n]:\n"
+      "      if i >= 0:\n"
+      "        if i >= 0:\n"
+      "          return f(n + 1) + 1\n"
+      "f(0)";
+  std::stringstream input(code);
+  Parser parser(input);
+  auto parsed = parser.parse();
+  auto layout = std::make_shared<FrameLayout>();
+  parsed->resolveScope(*layout);
+  auto message = [&](std::size_t maxDepth) {
+    auto ctx = std::make_shared<Context>();
+    ctx->setLayout(layout);
+    if (maxDepth != 0) ctx->setMaxCallDepth(maxDepth);
+    try {
+      parsed->execStatement(ctx);
+    } catch (ExecuteExceptionBase &e) {
+      return std::string(e.what());
+    }
+    return std::string();
+  };
+
+  BOOST_TEST(message(0).find("Stack limit reached at depth ") !=
+             std::string::npos);
+  BOOST_TEST(message(1000000000).find("Stack limit reached at depth ") !=
+             std::string::npos);
+  BOOST_TEST(message(100).find("Maximum recursion depth 100 exceeded.") !=
+             std::string::npos);
+}
+
+BOOST_AUTO_TEST_CASE(test_eval_node_fallback) {
+  class ConstantNode : public Instruction {
+   public:
+    std::shared_ptr<Value> exec(std::shared_ptr<Context> ctx) override {
+      return std::make_shared<Value>(7L);
+    }
+  };
+  auto code = std::make_unique<CodeBlock>();
+  auto expr = std::make_unique<Expression>();
+  expr->setArgument(std::make_unique<ConstantNode>());
+  code->addInstruction(std::make_unique<AssignExpr>(AssignExpr::Type::Assign,
+                                                    "x", std::move(expr)));
+
+  bytecode::Compiler compiler;
+  auto module = compiler.compile(*code);
+  auto ctx = std::make_shared<Context>();
+  bytecode::VirtualMachine vm(*module);
+  vm.run(ctx);
+
+  BOOST_TEST(ctx->getVariableValue("x")->getInt() == 7);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -4,27 +4,37 @@
 
 std::shared_ptr<Value> PrintFunction::exec(std::shared_ptr<Context> ctx) {
   for (int i = 0; i < ctx->parametersSize(); ++i) {
-    if (ctx->getParameter(i)->getType() == ValueType::Text)
-      out << ctx->getParameter(i)->getStr() << " ";
+    auto param = ctx->getParameter(i);
+    if (param->getType() == ValueType::Text)
+      out << param->getStr() << " ";
     else
-      out << ctx->getParameter(i)->toString() << " ";
+      out << param->toString() << " ";
   }
   out << "\n";
-  return std::make_shared<Value>(ValueType::None);
+  return Value::makeNone();
 }
 
 std::shared_ptr<Value> RangeFunction::exec(std::shared_ptr<Context> ctx) {
-  if (ctx->parametersSize() != PARAMS_SIZE)
-    throw ParametersCountNotExpected(name, ctx->parametersSize(), PARAMS_SIZE);
-
-  auto end = ctx->getParameter(0);
-  if (end->getType() != ValueType::Int) throw TypeNotExpected("int");
+  if (ctx->parametersSize() < MIN_PARAMS_SIZE)
+    throw ParametersCountNotExpected(name, ctx->parametersSize(),
+                                     MIN_PARAMS_SIZE);
+  if (ctx->parametersSize() > MAX_PARAMS_SIZE)
+    throw ParametersCountNotExpected(name, ctx->parametersSize(),
+                                     MAX_PARAMS_SIZE);
+
+  std::vector<int64_t> args;
+  for (int i = 0; i < ctx->parametersSize(); ++i) {
+    auto param = ctx->getParameter(i);
+    if (param->getType() != ValueType::Int) throw TypeNotExpected("int");
+    args.push_back(param->getInt());
+  }
 
-  std::vector<std::shared_ptr<Value>> elements;
-  for (int64_t i = 0; i < end->getInt(); ++i)
-    elements.push_back(std::make_shared<Value>(i));
+  int64_t start = args.size() > 1 ? args[0] : 0;
+  int64_t end = args.size() > 1 ? args[1] : args[0];
+  int64_t step = args.size() > 2 ? args[2] : 1;
+  if (step == 0) throw RangeStepZero();
 
-  return std::make_shared<Value>(elements);
+  return std::make_shared<Value>(Value::Range::fromBounds(start, end, step));
 }
 
 std::shared_ptr<Value> LenFunction::exec(std::shared_ptr<Context> ctx) {
@@ -36,11 +46,5 @@ std::shared_ptr<Value> LenFunction::exec(std::shared_ptr<Context> ctx) {
       input->getType() != ValueType::Text)
     throw TypeNotExpected("list, string");
 
-  int64_t size = 0;
-  if (input->getType() == ValueType::List)
-    size = input->getList().size();
-  else
-    size = input->getStr().size();
-
-  return std::make_shared<Value>(size);
+  return Value::makeInt(static_cast<int64_t>(input->size()));
 }
@@ -20,6 +20,8 @@ class PrintFunction : public Instruction {
   std::ostream &out;
 };
 
+// range(end), range(start, end) or range(start, end, step). Returns lazy
+// list, elements are created only if the list is used as a whole.
 class RangeFunction : public Instruction {
  public:
   RangeFunction() {}
@@ -28,7 +30,8 @@ class RangeFunction : public Instruction {
   std::shared_ptr<Value> exec(std::shared_ptr<Context> ctx) override;
 
  private:
-  const int PARAMS_SIZE = 1;
+  const int MIN_PARAMS_SIZE = 1;
+  const int MAX_PARAMS_SIZE = 3;
   std::string name = "range";
 };
 
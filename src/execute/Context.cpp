@@ -2,25 +2,76 @@
 
 #include "Context.h"
 
+#include <sys/resource.h>
+
 std::shared_ptr<Instruction> Context::getFunction(std::string name) {
-  if (funcs.count(name) == 1) return funcs[name];
+  auto found = funcs.find(name);
+  if (found != funcs.end()) return found->second;
   if (parent == nullptr) return nullptr;
   return parent->getFunction(name);
 }
 
+std::shared_ptr<Instruction> Context::getOwnFunction(const std::string &name) {
+  auto found = funcs.find(name);
+  if (found == funcs.end()) return nullptr;
+  return found->second;
+}
+
 void Context::setFunction(std::string name, std::shared_ptr<Instruction> func) {
   if (funcs.count(name) != 0)
     throw std::runtime_error("Try to redefine function");
   funcs[name] = func;
 }
 
-std::shared_ptr<Value> Context::getVariableValue(std::string name) {
-  if (vars.count(name) == 1) return vars[name];
+std::shared_ptr<Value> Context::getVariableValue(const std::string &name) {
+  int slot = layout != nullptr ? layout->slotOf(name) : -1;
+  if (slot >= 0 && slots[slot] != nullptr) return slots[slot];
+  if (slot < 0) {
+    auto found = vars.find(name);
+    if (found != vars.end()) return found->second;
+  }
   if (parent == nullptr) return nullptr;
   return parent->getVariableValue(name);
 }
 
+void Context::setVariable(const std::string &name,
+                          std::shared_ptr<Value> value) {
+  int slot = layout != nullptr ? layout->slotOf(name) : -1;
+  if (slot >= 0)
+    slots[slot] = std::move(value);
+  else
+    vars[name] = std::move(value);
+}
+
+void Context::setLayout(std::shared_ptr<const FrameLayout> frameLayout) {
+  layout = frameLayout;
+  slots.assign(layout != nullptr ? layout->size() : 0, nullptr);
+}
+
+void Context::setCounter(int slot, const std::string &name,
+                         std::shared_ptr<Value> &counter, std::int64_t value) {
+  if (counter != nullptr && counter.use_count() == 2 && slot >= 0 &&
+      slot < slots.size() && slots[slot] == counter) {
+    counter->setInt(value);
+    return;
+  }
+  counter = std::make_shared<Value>(value);
+  setVariable(slot, name, counter);
+}
+
 std::shared_ptr<Value> Context::getParameter(size_t index) {
   if (index < params.size()) return params[index];
   return nullptr;
 }
+
+std::size_t Context::stackBudget() {
+  static const std::size_t budget = [] {
+    std::size_t size = 8 << 20;
+    rlimit limit;
+    if (getrlimit(RLIMIT_STACK, &limit) == 0 &&
+        limit.rlim_cur != RLIM_INFINITY)
+      size = limit.rlim_cur;
+    return size / 4 * 3;
+  }();
+  return budget;
+}
@@ -3,32 +3,154 @@
 #ifndef SRC_EXECUTE_CONTEXT_H_
 #define SRC_EXECUTE_CONTEXT_H_
 
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
 #include <map>
 #include <memory>
 #include <string>
 #include <vector>
 
+#include "FrameLayout.h"
 #include "Instructions.h"
 #include "Value.h"
 
 class Context {
  public:
+  // Calls in tree walker recurse on the native stack, by default they are
+  // limited only by the part of it they may use, see stackBudget()
+  static constexpr std::size_t defaultMaxCallDepth =
+      std::numeric_limits<std::size_t>::max();
+
   Context() {}
-  explicit Context(std::shared_ptr<Context> parentContext)
-      : parent(parentContext) {}
+  explicit Context(std::shared_ptr<Context> parentContext) {
+    setParent(parentContext);
+  }
+  Context(const Context &) = delete;
+  Context &operator=(const Context &) = delete;
+
+  void setParent(std::shared_ptr<Context> parentContext) {
+    parent = parentContext;
+    global = parent != nullptr ? parent->global : this;
+  }
+  const std::shared_ptr<Context> &getParent() const { return parent; }
+  // Context at the end of the chain of parents, kept alive by each of them
+  Context &getGlobal() { return *global; }
+
+  // Context `depth` scopes up the chain of parents, or the global one, where
+  // the function found by FrameLayout::findFunction() was defined
+  static const std::shared_ptr<Context> &enclosing(
+      const std::shared_ptr<Context> &ctx, int depth) {
+    auto scope = &ctx;
+    for (int i = 0; (depth == VariableRef::Global || i < depth) &&
+                    (*scope)->parent != nullptr;
+         ++i)
+      scope = &(*scope)->parent;
+    return *scope;
+  }
+
   std::shared_ptr<Instruction> getFunction(std::string name);
+  // Function defined in this context, without looking into parents
+  std::shared_ptr<Instruction> getOwnFunction(const std::string &name);
   void setFunction(std::string name, std::shared_ptr<Instruction> func);
-  std::shared_ptr<Value> getVariableValue(std::string name);
-  void setVariable(std::string name, std::shared_ptr<Value> value) {
-    vars[name] = value;
+  std::shared_ptr<Value> getVariableValue(const std::string &name);
+  void setVariable(const std::string &name, std::shared_ptr<Value> value);
+
+  // Variables resolved to slots of the layout are kept in the frame, others
+  // (not resolved or declared outside of the scope) are stored by name.
+  void setLayout(std::shared_ptr<const FrameLayout> frameLayout);
+  std::shared_ptr<Value> getVariableValue(int slot, const std::string &name) {
+    if (slot >= 0 && static_cast<std::size_t>(slot) < slots.size() &&
+        slots[slot] != nullptr)
+      return slots[slot];
+    return getVariableValue(name);
+  }
+  std::shared_ptr<Value> getVariableValue(const VariableRef &ref,
+                                          const std::string &name) {
+    auto frame = ref.depth == VariableRef::Global ? global : this;
+    for (int i = 0; i < ref.depth && frame != nullptr; ++i)
+      frame = frame->parent.get();
+    if (frame != nullptr && ref.slot >= 0 &&
+        static_cast<std::size_t>(ref.slot) < frame->slots.size() &&
+        frame->slots[ref.slot] != nullptr)
+      return frame->slots[ref.slot];
+    return getVariableValue(name);
+  }
+  void setVariable(int slot, const std::string &name,
+                   std::shared_ptr<Value> value) {
+    if (slot >= 0 && static_cast<std::size_t>(slot) < slots.size())
+      slots[slot] = std::move(value);
+    else
+      setVariable(name, std::move(value));
   }
+
+  // Sets integer iterator of the counted loop. Value kept in `counter` is
+  // changed in place when only the slot and the loop refer to it, so it is
+  // never taken from the small integers cache.
+  void setCounter(int slot, const std::string &name,
+                  std::shared_ptr<Value> &counter, std::int64_t value);
+
   std::shared_ptr<Value> getParameter(size_t index);
   void addParameter(std::shared_ptr<Value> param) { params.push_back(param); }
   size_t parametersSize() { return params.size(); }
 
+  // Value of the executed return statement, see Flow::Return
+  void setReturnValue(std::shared_ptr<Value> value) {
+    returnValue = std::move(value);
+  }
+  std::shared_ptr<Value> takeReturnValue() { return std::move(returnValue); }
+
+  // Function executed in the context, see FunctionCall::execTailCall()
+  void setExecutedFunction(const Instruction *function) {
+    executedFunction = function;
+  }
+  const Instruction *getExecutedFunction() const { return executedFunction; }
+  // Arguments of the self call in tail position, returned instead of a value
+  void setTailCall(std::vector<std::shared_ptr<Value>> arguments) {
+    tailArguments = std::move(arguments);
+    tailCall = true;
+  }
+  bool hasTailCall() const { return tailCall; }
+
+  // Depth of script calls in the tree walker, counted in the global context.
+  // enterCall() throws RecursionTooDeep when the limit is exceeded and
+  // StackLimitReached when the calls have used the stack budget since the
+  // outermost one (the stack grows down).
+  void setMaxCallDepth(std::size_t depth) { global->maxCallDepth = depth; }
+  void enterCall() {
+    char marker;
+    auto address = reinterpret_cast<std::uintptr_t>(&marker);
+    if (global->callDepth == 0)
+      global->stackLimit = address - std::min(address, stackBudget());
+    if (global->callDepth >= global->maxCallDepth)
+      throw RecursionTooDeep(global->maxCallDepth);
+    if (address < global->stackLimit)
+      throw StackLimitReached(global->callDepth);
+    ++global->callDepth;
+  }
+  void leaveCall() { --global->callDepth; }
+  // Part of RLIMIT_STACK the calls may use, the rest is left for the frames
+  // below the outermost call and the native code between two calls
+  static std::size_t stackBudget();
+  std::vector<std::shared_ptr<Value>> takeTailCall() {
+    tailCall = false;
+    return std::move(tailArguments);
+  }
+
  private:
   std::shared_ptr<Context> parent = nullptr;
+  Context *global = this;
+  std::shared_ptr<const FrameLayout> layout = nullptr;
+  std::vector<std::shared_ptr<Value>> slots;
   std::vector<std::shared_ptr<Value>> params;
+  std::shared_ptr<Value> returnValue = nullptr;
+  const Instruction *executedFunction = nullptr;
+  std::vector<std::shared_ptr<Value>> tailArguments;
+  bool tailCall = false;
+  std::size_t callDepth = 0;
+  std::size_t maxCallDepth = defaultMaxCallDepth;
+  std::uintptr_t stackLimit = 0;
   std::map<std::string, std::shared_ptr<Instruction>> funcs;
   std::map<std::string, std::shared_ptr<Value>> vars;
 };
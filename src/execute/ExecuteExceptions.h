@@ -3,6 +3,7 @@
 #ifndef SRC_EXECUTE_EXECUTEEXCEPTIONS_H_
 #define SRC_EXECUTE_EXECUTEEXCEPTIONS_H_
 
+#include <cstddef>
 #include <exception>
 #include <string>
 
@@ -85,6 +86,30 @@ class ParametersCountNotExpected : public ExecuteExceptionBase {
   }
 };
 
+class RangeStepZero : public ExecuteExceptionBase {
+ public:
+  RangeStepZero() : ExecuteExceptionBase() {
+    message += "Step of the range cannot be zero.";
+  }
+};
+
+class RecursionTooDeep : public ExecuteExceptionBase {
+ public:
+  explicit RecursionTooDeep(std::size_t maxDepth) : ExecuteExceptionBase() {
+    message += "Maximum recursion depth " + std::to_string(maxDepth) +
+               " exceeded.";
+  }
+};
+
+// Calls of tree walker used the part of the native stack they may use
+// before reaching the maximum depth
+class StackLimitReached : public ExecuteExceptionBase {
+ public:
+  explicit StackLimitReached(std::size_t depth) : ExecuteExceptionBase() {
+    message += "Stack limit reached at depth " + std::to_string(depth) + ".";
+  }
+};
+
 class TypeNotExpected : public ExecuteExceptionBase {
  public:
   explicit TypeNotExpected(std::string expected) : ExecuteExceptionBase() {
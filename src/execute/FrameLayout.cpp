@@ -0,0 +1,63 @@
+// Copyright 2019 Kamil Mankowski
+
+#include "FrameLayout.h"
+
+int FrameLayout::declare(const std::string &name) {
+  auto found = slots.find(name);
+  if (found != slots.end()) return found->second;
+
+  names.push_back(name);
+  int slot = names.size() - 1;
+  slots[name] = slot;
+  return slot;
+}
+
+int FrameLayout::slotOf(const std::string &name) const {
+  auto found = slots.find(name);
+  if (found == slots.end()) return -1;
+  return found->second;
+}
+
+VariableRef FrameLayout::find(const std::string &name) const {
+  int depth = 0;
+  for (auto layout = this; layout != nullptr; layout = layout->enclosing) {
+    int slot = layout->slotOf(name);
+    if (slot < 0) {
+      ++depth;
+      continue;
+    }
+    if (layout->enclosing == nullptr && depth > 0)
+      return VariableRef{VariableRef::Global, slot};
+    return VariableRef{depth, slot};
+  }
+  return VariableRef{0, -1};
+}
+
+void FrameLayout::declareFunction(const std::string &name,
+                                  Function *function) {
+  auto found = functions.find(name);
+  if (found == functions.end())
+    functions[name] = function;
+  else if (found->second != function)
+    found->second = nullptr;
+}
+
+FunctionRef FrameLayout::findFunction(const std::string &name,
+                                      bool reached) const {
+  int depth = 0;
+  bool byName = false;
+  for (auto layout = this; layout != nullptr;
+       layout = layout->enclosing, ++depth) {
+    auto found = layout->functions.find(name);
+    if (found == layout->functions.end()) continue;
+    if (found->second == nullptr ||
+        (reached && layout == this && reachedFunctions.count(name) == 0)) {
+      byName = true;
+      continue;
+    }
+    if (layout->enclosing == nullptr && depth > 0)
+      return FunctionRef{VariableRef::Global, found->second, byName};
+    return FunctionRef{depth, found->second, byName};
+  }
+  return FunctionRef{0, nullptr, byName};
+}
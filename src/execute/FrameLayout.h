@@ -0,0 +1,65 @@
+// Copyright 2019 Kamil Mankowski
+
+#ifndef SRC_EXECUTE_FRAMELAYOUT_H_
+#define SRC_EXECUTE_FRAMELAYOUT_H_
+
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+class Function;
+
+// Variable resolved in the chain of scopes: slot in the frame `depth`
+// definitions up, or in the global frame.
+struct VariableRef {
+  enum { Global = -1 };
+  int depth;
+  int slot;
+};
+
+// Function found in the chain of scopes, defined `depth` scopes up or in the
+// global scope. Function is nullptr when no definition is bound to the name.
+// When a nearer scope defines the name conditionally (or more than once),
+// the call looks the name up first and the bound function is the fallback.
+struct FunctionRef {
+  int depth;
+  Function *function;
+  bool byName;
+};
+
+// Variables of one scope (program or function body) resolved to slot
+// indexes before execution. Context of the scope keeps values in slots.
+class FrameLayout {
+ public:
+  // Enclosing layout is used only while resolving, it has to outlive that
+  explicit FrameLayout(const FrameLayout *enclosing = nullptr)
+      : enclosing(enclosing) {}
+
+  int declare(const std::string &name);
+  int slotOf(const std::string &name) const;
+  const std::string &nameOf(int slot) const { return names[slot]; }
+  size_t size() const { return names.size(); }
+
+  // Finds scope declaring the name, slot is -1 when nothing declares it
+  VariableRef find(const std::string &name) const;
+
+  // Table of functions defined in the scope. Name defined by more than one
+  // definition, or with nullptr for definitions in conditional and loop
+  // blocks, is not bound and its calls look the function up by name.
+  void declareFunction(const std::string &name, Function *function);
+  // Marks the definition as resolved. Calls placed before it in the scope
+  // itself run before it is executed, with `reached` set they skip it, so
+  // they look the name up as well.
+  void reachFunction(const std::string &name) { reachedFunctions.insert(name); }
+  FunctionRef findFunction(const std::string &name, bool reached = false) const;
+
+ private:
+  const FrameLayout *enclosing;
+  std::vector<std::string> names;
+  std::unordered_map<std::string, int> slots;
+  std::unordered_map<std::string, Function *> functions;
+  std::unordered_set<std::string> reachedFunctions;
+};
+
+#endif  // SRC_EXECUTE_FRAMELAYOUT_H_
@@ -13,34 +13,90 @@
 #include <vector>
 
 #include "ExecuteExceptions.h"
+#include "FrameLayout.h"
 #include "Value.h"
 
 class Context;
+class FunctionPointer;
+class Optimizer;
+namespace bytecode {
+class Compiler;
+}  // namespace bytecode
+
+// How the statement finished. Value of the return is kept in the Context.
+enum class Flow : std::uint8_t { Normal, Break, Continue, Return };
+
 class Instruction {
  public:
   virtual std::string toString() { return "Instruction"; }
   virtual std::string instrName() { return "__UNNAMED_INSTR"; }
   virtual std::shared_ptr<Value> exec(std::shared_ptr<Context> ctx) {
-    return std::make_shared<Value>();
+    return Value::makeNone();
+  }
+  // Executes the node as a statement, by default the result is dropped
+  virtual Flow execStatement(std::shared_ptr<Context> ctx) {
+    exec(ctx);
+    return Flow::Normal;
+  }
+  // Value known without execution (literal), nullptr if it must be computed.
+  // It is shared by all executions and must not be changed.
+  virtual std::shared_ptr<Value> constantValue() { return nullptr; }
+
+  // Lowering to bytecode. Expressions leave exactly one value on the stack,
+  // statements leave the stack untouched. Nodes without own lowering are
+  // evaluated by the tree walker from inside the VM.
+  virtual void compile(bytecode::Compiler &compiler);
+  virtual void compileStatement(bytecode::Compiler &compiler);
+
+  // Assigns frame slots to variables referenced in the scope of the layout.
+  // Nodes which are not resolved use lookup by name.
+  virtual void declare(FrameLayout &layout) {}
+  virtual void resolve(FrameLayout &layout) {}
+
+  // Rewrites subexpressions of the node before resolving, see Optimizer
+  virtual void optimize(Optimizer &optimizer) {}
+  // Copy of the node for the body of inlined function, with variables
+  // renamed by the optimizer. nullptr when the node cannot be inlined.
+  virtual std::unique_ptr<Instruction> inlineCopy(Optimizer &optimizer) {
+    return nullptr;
   }
 };
 
-class CodeBlock : public Instruction {
+// Node executed only as a statement, result of exec() is always None
+class Statement : public Instruction {
+ public:
+  std::shared_ptr<Value> exec(std::shared_ptr<Context> ctx) override {
+    execStatement(ctx);
+    return Value::makeNone();
+  }
+  Flow execStatement(std::shared_ptr<Context> ctx) override = 0;
+};
+
+class CodeBlock : public Statement {
  public:
   void addInstruction(std::unique_ptr<Instruction> instr) {
     instructions.push_back(std::move(instr));
   }
   bool empty() { return instructions.empty(); }
+  const std::vector<std::unique_ptr<Instruction>> &getInstructions() const {
+    return instructions;
+  }
 
   std::string toString() override;
-  std::shared_ptr<Value> exec(std::shared_ptr<Context> ctx) override;
+  Flow execStatement(std::shared_ptr<Context> ctx) override;
+  void compileStatement(bytecode::Compiler &compiler) override;
+  void declare(FrameLayout &layout) override;
+  void resolve(FrameLayout &layout) override;
+  void optimize(Optimizer &optimizer) override;
+
+  // Resolves the block as a body of the scope
+  void resolveScope(FrameLayout &layout);
 
  private:
   std::vector<std::unique_ptr<Instruction>> instructions;
-  bool isResultToReturn(std::shared_ptr<Value> result);
 };
 
-class Function : public Instruction {
+class Function : public Statement {
  public:
   explicit Function(const std::string &name) : name(name) {}
 
@@ -48,15 +104,32 @@ class Function : public Instruction {
   void setCode(std::unique_ptr<CodeBlock> cb) { code = std::move(cb); }
 
   bool empty() { return code == nullptr || code->empty(); }
+  const std::vector<std::string> &getArguments() const {
+    return argumentNames;
+  }
+  CodeBlock *getCode() { return code.get(); }
+  // Function bound in the table of the enclosing scope, valid after resolve()
+  FunctionPointer &getPointer() { return *pointer; }
 
   std::string instrName() override { return name; }
   std::string toString() override;
-  std::shared_ptr<Value> exec(std::shared_ptr<Context> ctx) override;
+  Flow execStatement(std::shared_ptr<Context> ctx) override;
+  void compileStatement(bytecode::Compiler &compiler) override;
+  // Reached only for definitions in conditional and loop blocks
+  void declare(FrameLayout &layout) override;
+  void resolve(FrameLayout &outer) override;
+  void optimize(Optimizer &optimizer) override;
 
  private:
   std::unique_ptr<CodeBlock> code = nullptr;
   std::vector<std::string> argumentNames;
   std::string name;
+  std::shared_ptr<FrameLayout> layout = nullptr;
+  std::vector<int> argumentSlots;
+  // Set by resolve() when calls find the function in the table of the scope,
+  // executing the definition does nothing then
+  std::shared_ptr<FunctionPointer> pointer = nullptr;
+  bool bound = false;
 };
 
 class Variable : public Instruction {
@@ -64,25 +137,46 @@ class Variable : public Instruction {
   explicit Variable(std::string name) : name(name) {}
   std::string toString() override { return name; }
   std::shared_ptr<Value> exec(std::shared_ptr<Context> ctx) override;
+  void compile(bytecode::Compiler &compiler) override;
+  void resolve(FrameLayout &layout) override;
+  std::unique_ptr<Instruction> inlineCopy(Optimizer &optimizer) override;
 
  private:
   std::string name;
+  VariableRef ref = {0, -1};
 };
 
 class Constant : public Instruction {
  public:
-  explicit Constant(ValueType _type) : type(_type) {}
-  explicit Constant(bool value) : type(ValueType::Bool), boolValue(value) {}
+  explicit Constant(ValueType _type) : type(_type) { makeValue(); }
+  explicit Constant(bool value) : type(ValueType::Bool), boolValue(value) {
+    makeValue();
+  }
   explicit Constant(std::int64_t value)
-      : type(ValueType::Int), intValue(value) {}
-  explicit Constant(double value) : type(ValueType::Real), realValue(value) {}
+      : type(ValueType::Int), intValue(value) {
+    makeValue();
+  }
+  explicit Constant(double value) : type(ValueType::Real), realValue(value) {
+    makeValue();
+  }
   explicit Constant(std::string value)
-      : type(ValueType::Text), strValue(value) {}
+      : type(ValueType::Text), strValue(value) {
+    makeValue();
+  }
   explicit Constant(std::vector<std::unique_ptr<Instruction>> &&elements)
-      : type(ValueType::List), listElements(std::move(elements)) {}
+      : type(ValueType::List), listElements(std::move(elements)) {
+    makeValue();
+  }
+  // Constant of the value computed before execution
+  explicit Constant(std::shared_ptr<Value> value);
 
   std::string toString() override;
   std::shared_ptr<Value> exec(std::shared_ptr<Context> ctx) override;
+  std::shared_ptr<Value> constantValue() override { return value; }
+  void compile(bytecode::Compiler &compiler) override;
+  void resolve(FrameLayout &layout) override;
+  void optimize(Optimizer &optimizer) override;
+  std::unique_ptr<Instruction> inlineCopy(Optimizer &optimizer) override;
 
  private:
   ValueType type;
@@ -91,7 +185,11 @@ class Constant : public Instruction {
   bool boolValue;
   std::string strValue;
   std::vector<std::unique_ptr<Instruction>> listElements;
+  // Built once by the constructor, nullptr for the list with elements which
+  // are not constant
+  std::shared_ptr<Value> value;
 
+  void makeValue();
   std::string listToString();
 };
 
@@ -105,6 +203,14 @@ class Slice : public Instruction {
 
   std::string toString() override;
   std::shared_ptr<Value> exec(std::shared_ptr<Context> ctx) override;
+  void compile(bytecode::Compiler &compiler) override;
+  void resolve(FrameLayout &layout) override;
+  void optimize(Optimizer &optimizer) override;
+  std::unique_ptr<Instruction> inlineCopy(Optimizer &optimizer) override;
+
+  static std::shared_ptr<Value> slice(std::shared_ptr<Value> sourceValue,
+                                      SliceType type, int start, int end,
+                                      const std::string &sourceName);
 
  private:
   SliceType type;
@@ -122,90 +228,212 @@ class FunctionCall : public Instruction {
 
   std::string toString() override;
   std::shared_ptr<Value> exec(std::shared_ptr<Context> ctx) override;
+  void compile(bytecode::Compiler &compiler) override;
+  void resolve(FrameLayout &layout) override;
+  void optimize(Optimizer &optimizer) override;
+  std::unique_ptr<Instruction> inlineCopy(Optimizer &optimizer) override;
+
+  // Body of the called function put in place of the call, nullptr when the
+  // optimizer has no body to inline for it
+  std::unique_ptr<Instruction> inlineCall(Optimizer &optimizer);
+
+  // Call in `return f(...)`. When it calls the function executed in the
+  // context, arguments are left for FunctionPointer::exec() to run it again
+  // instead of recursion and true is returned.
+  bool execTailCall(std::shared_ptr<Context> ctx);
+  void compileTailCall(bytecode::Compiler &compiler);
+
+ private:
+  std::string name;
+  std::vector<std::unique_ptr<Instruction>> args;
+  // Definition bound by resolve(), otherwise (or first, when it can be
+  // shadowed) the function is looked up by name when called
+  FunctionRef target = {0, nullptr, false};
+
+  void compileCallee(bytecode::Compiler &compiler);
+};
+
+// Call of a small function replaced by the copy of its body. Arguments are
+// assigned to the renamed parameters in the scope of the call, then the
+// statements and the returned expression are executed there. Afterwards the
+// renamed parameters and variables are unset, so they do not keep values
+// alive in the scope.
+class InlinedCall : public Instruction {
+ public:
+  InlinedCall(std::string name, std::vector<std::string> parameters)
+      : name(name), parameters(parameters) {}
+
+  void addArgument(std::unique_ptr<Instruction> arg) {
+    args.push_back(std::move(arg));
+  }
+  void addStatement(std::unique_ptr<Instruction> statement) {
+    statements.push_back(std::move(statement));
+  }
+  void setResult(std::unique_ptr<Instruction> value) {
+    result = std::move(value);
+  }
+  size_t parametersSize() const { return parameters.size(); }
+
+  std::string instrName() override { return name; }
+  std::string toString() override;
+  std::shared_ptr<Value> exec(std::shared_ptr<Context> ctx) override;
+  void compile(bytecode::Compiler &compiler) override;
+  void resolve(FrameLayout &layout) override;
+
+  // Copy of the body without arguments, for the next call site
+  std::unique_ptr<InlinedCall> copyBody(Optimizer &optimizer);
 
  private:
   std::string name;
+  std::vector<std::string> parameters;
+  std::vector<int> slots;
+  // Parameters followed by variables assigned in the body, with their slots
+  std::vector<std::string> renamed;
+  std::vector<int> renamedSlots;
   std::vector<std::unique_ptr<Instruction>> args;
+  std::vector<std::unique_ptr<Instruction>> statements;
+  std::unique_ptr<Instruction> result;
 };
 
-class Return : public Instruction {
+class Return : public Statement {
  public:
   void setValue(std::unique_ptr<Instruction> val) { value = std::move(val); }
+  Instruction *getValue() { return value.get(); }
   std::string toString() override { return "return " + value->toString(); }
-  std::shared_ptr<Value> exec(std::shared_ptr<Context> ctx) override;
+  Flow execStatement(std::shared_ptr<Context> ctx) override;
+  void compileStatement(bytecode::Compiler &compiler) override;
+  void resolve(FrameLayout &layout) override;
+  void optimize(Optimizer &optimizer) override;
 
  private:
   std::unique_ptr<Instruction> value;
+  // Set by resolve() when the returned value is a call
+  FunctionCall *tailCall = nullptr;
 };
 
 class Expression : public Instruction {
  public:
   enum Type { None, Add, Sub, Mul, Div, Exp };
+  // Computes the operation for one combination of operand types
+  using Kernel = std::shared_ptr<Value> (*)(Value &left, Value &right);
+
+  // Place in the code where the operation is executed. Keeps the kernel
+  // specialized for operand types seen first and uses it while the types
+  // repeat, after other types are seen it falls back to evaluate().
+  class Site {
+   public:
+    std::shared_ptr<Value> evaluate(const std::shared_ptr<Value> &left,
+                                    const std::shared_ptr<Value> &right,
+                                    Expression::Type op);
+
+   private:
+    ValueType leftType = ValueType::None;
+    ValueType rightType = ValueType::None;
+    Kernel kernel = nullptr;
+    bool generic = false;
+  };
 
   Expression() {}
 
   std::string toString() override;
 
   void setArgument(std::unique_ptr<Instruction> arg) {
-    args.push_back(std::move(arg));
+    args.push_back(flatten(std::move(arg)));
+  }
+  void setType(Type type) {
+    types.push_back(type);
+    sites.emplace_back();
   }
-  void setType(Type type) { types.push_back(type); }
   std::shared_ptr<Value> exec(std::shared_ptr<Context> ctx) override;
+  std::shared_ptr<Value> constantValue() override;
+  void compile(bytecode::Compiler &compiler) override;
+  void resolve(FrameLayout &layout) override;
+  void optimize(Optimizer &optimizer) override;
+  std::unique_ptr<Instruction> inlineCopy(Optimizer &optimizer) override;
 
   static std::string typeToString(Type _type);
-  static bool checkCompatibility(ValueType left, ValueType right,
-                                 Expression::Type op);
-  static std::shared_ptr<Value> makeExpression(std::shared_ptr<Value> left,
-                                               std::shared_ptr<Value> right,
-                                               Expression::Type op);
+  // Operand of the expression without operations, so it is executed without
+  // the pass-through layer; other instructions are returned unchanged
+  static std::unique_ptr<Instruction> flatten(
+      std::unique_ptr<Instruction> instr);
+  // Kernel for the types of operands, nullptr when they are not compatible
+  static Kernel findKernel(ValueType left, ValueType right, Type op);
+  // Computes the operation by the kernel selected for types of operands,
+  // throws when the types are not compatible
+  static std::shared_ptr<Value> evaluate(const std::shared_ptr<Value> &left,
+                                         const std::shared_ptr<Value> &right,
+                                         Expression::Type op);
 
  private:
   Type type;
   std::vector<Type> types;
+  std::vector<Site> sites;
   std::vector<std::unique_ptr<Instruction>> args;
-  static std::map<ValueType, std::map<Expression::Type, std::vector<ValueType>>>
-      allowedOperands;
-
-  static std::shared_ptr<Value> execExprList(std::shared_ptr<Value> list,
-                                             std::shared_ptr<Value> right,
-                                             Type op);
-  static std::shared_ptr<Value> execExprStr(std::shared_ptr<Value> str,
-                                            std::shared_ptr<Value> right,
-                                            Type op);
-  static std::shared_ptr<Value> execExprInt(int64_t left, int64_t right,
-                                            Type op);
-  static std::shared_ptr<Value> execExprReal(double left, double right,
-                                             Type op);
+  // Result is known to be a number, set by the optimizer
+  bool numeric = false;
+
+  static bool isNumber(Instruction &instr);
 };
 
 class CompareExpr : public Instruction {
  public:
   enum Type { NoComp, Greater, GreaterEq, Less, LessEq, Different, Equal };
-  explicit CompareExpr(std::unique_ptr<Expression> left)
-      : type(Type::NoComp), leftExpr(std::move(left)), rightExpr(nullptr) {}
-  CompareExpr(Type type, std::unique_ptr<Expression> left,
-              std::unique_ptr<Expression> right)
-      : type(type), leftExpr(std::move(left)), rightExpr(std::move(right)) {}
+  explicit CompareExpr(std::unique_ptr<Instruction> left)
+      : type(Type::NoComp),
+        leftExpr(Expression::flatten(std::move(left))),
+        rightExpr(nullptr) {}
+  CompareExpr(Type type, std::unique_ptr<Instruction> left,
+              std::unique_ptr<Instruction> right)
+      : type(type),
+        leftExpr(Expression::flatten(std::move(left))),
+        rightExpr(Expression::flatten(std::move(right))) {}
 
   std::string toString() override;
   std::shared_ptr<Value> exec(std::shared_ptr<Context> ctx) override;
+  void compile(bytecode::Compiler &compiler) override;
+  void resolve(FrameLayout &layout) override;
+  void optimize(Optimizer &optimizer) override;
+  std::unique_ptr<Instruction> inlineCopy(Optimizer &optimizer) override;
+
+  // Condition of If and While, the result is not boxed in a Value
+  bool isTrue(std::shared_ptr<Context> ctx);
+  // Emits evaluation of the condition followed by the jump taken when it is
+  // false, returns the position of the jump to patch
+  std::int32_t compileCondition(bytecode::Compiler &compiler);
+
+  bool isComparison() const { return type != NoComp; }
+  // Operand of the comparison without operator, taken out of it
+  std::unique_ptr<Instruction> releaseOperand() { return std::move(leftExpr); }
 
   static bool isFalseEquivalent(std::shared_ptr<Value> val);
+  static bool evaluate(std::shared_ptr<Value> left,
+                       std::shared_ptr<Value> right, CompareExpr::Type cmp);
 
  private:
+  // Type of both operands seen so far. Comparison of values of that type is
+  // done directly, operands of other types use the generic evaluate().
+  enum class Feedback : std::uint8_t { Unset, Int, Real, Text, Generic };
+
   Type type;
-  std::unique_ptr<Expression> leftExpr;
-  std::unique_ptr<Expression> rightExpr;
-  bool checkEqual(std::shared_ptr<Value> left, std::shared_ptr<Value> right);
-  bool checkEqualList(std::shared_ptr<Value> left,
-                      std::shared_ptr<Value> right);
-  bool checkTypeCompatibility(ValueType left, ValueType right);
-  bool compare(std::shared_ptr<Value> left, std::shared_ptr<Value> right,
-               CompareExpr::Type cmp);
+  Feedback feedback = Feedback::Unset;
+  std::unique_ptr<Instruction> leftExpr;
+  std::unique_ptr<Instruction> rightExpr;
+
+  bool evaluateSpecialized(const std::shared_ptr<Value> &left,
+                           const std::shared_ptr<Value> &right);
+  static bool checkEqual(const std::shared_ptr<Value> &left,
+                         const std::shared_ptr<Value> &right);
+  static bool checkEqualList(const std::shared_ptr<Value> &left,
+                             const std::shared_ptr<Value> &right);
+  static bool checkTypeCompatibility(ValueType left, ValueType right);
+  static bool compare(const std::shared_ptr<Value> &left,
+                      const std::shared_ptr<Value> &right,
+                      CompareExpr::Type cmp);
   template <typename T>
-  bool compare(T left, T right, CompareExpr::Type cmp);
-  bool compareList(std::shared_ptr<Value> left, std::shared_ptr<Value> right,
-                   CompareExpr::Type cmp);
+  static bool compare(const T &left, const T &right, CompareExpr::Type cmp);
+  static bool compareList(const std::shared_ptr<Value> &left,
+                          const std::shared_ptr<Value> &right,
+                          CompareExpr::Type cmp);
 
   std::string operatorToString();
 };
@@ -213,41 +441,58 @@ class CompareExpr : public Instruction {
 class AssignExpr : public Instruction {
  public:
   enum Type { Assign, AddAssign, SubAssign };
-  AssignExpr(Type type, std::string name, std::unique_ptr<Expression> expr)
+  AssignExpr(Type type, std::string name, std::unique_ptr<Instruction> expr)
       : type(type), variableName(name), expression(std::move(expr)) {}
 
   std::string toString() override;
   std::shared_ptr<Value> exec(std::shared_ptr<Context> ctx) override;
+  void compileStatement(bytecode::Compiler &compiler) override;
+  void declare(FrameLayout &layout) override;
+  void resolve(FrameLayout &layout) override;
+  void optimize(Optimizer &optimizer) override;
+  std::unique_ptr<Instruction> inlineCopy(Optimizer &optimizer) override;
+  // Name defined by the assignment, empty for += and -=
+  std::string definedName() const {
+    return type == Type::Assign ? variableName : "";
+  }
 
  private:
   Type type;
   std::string variableName;
-  std::unique_ptr<Expression> expression;
+  int slot = -1;
+  std::unique_ptr<Instruction> expression;
+  Expression::Site site;
 };
 
-class Continue : public Instruction {
+class Continue : public Statement {
  public:
   std::string toString() override { return "continue"; }
-  std::shared_ptr<Value> exec(std::shared_ptr<Context> ctx) {
-    return std::make_shared<Value>(ValueType::T_CONTINUE);
+  Flow execStatement(std::shared_ptr<Context> ctx) override {
+    return Flow::Continue;
   }
+  void compileStatement(bytecode::Compiler &compiler) override;
 };
 
-class Break : public Instruction {
+class Break : public Statement {
  public:
   std::string toString() override { return "break"; }
-  std::shared_ptr<Value> exec(std::shared_ptr<Context> ctx) {
-    return std::make_shared<Value>(ValueType::T_BREAK);
+  Flow execStatement(std::shared_ptr<Context> ctx) override {
+    return Flow::Break;
   }
+  void compileStatement(bytecode::Compiler &compiler) override;
 };
 
-class If : public Instruction {
+class If : public Statement {
  public:
   If(std::unique_ptr<CompareExpr> compare, std::unique_ptr<CodeBlock> ifCode)
       : compare(std::move(compare)), ifCode(std::move(ifCode)) {}
 
   std::string toString() override;
-  std::shared_ptr<Value> exec(std::shared_ptr<Context> ctx) override;
+  Flow execStatement(std::shared_ptr<Context> ctx) override;
+  void compileStatement(bytecode::Compiler &compiler) override;
+  void declare(FrameLayout &layout) override;
+  void resolve(FrameLayout &layout) override;
+  void optimize(Optimizer &optimizer) override;
 
  private:
   std::unique_ptr<CompareExpr> compare;
@@ -255,26 +500,37 @@ class If : public Instruction {
   std::unique_ptr<CodeBlock> elseCode = nullptr;  // TD
 };
 
-class For : public Instruction {
+class For : public Statement {
  public:
   For(std::string iterator, std::unique_ptr<Instruction> range,
       std::unique_ptr<CodeBlock> code)
       : iterator(iterator), range(std::move(range)), code(std::move(code)) {}
   std::string toString() override;
-  std::shared_ptr<Value> exec(std::shared_ptr<Context> ctx) override;
+  Flow execStatement(std::shared_ptr<Context> ctx) override;
+  void compileStatement(bytecode::Compiler &compiler) override;
+  void declare(FrameLayout &layout) override;
+  void resolve(FrameLayout &layout) override;
+  void optimize(Optimizer &optimizer) override;
 
  private:
   std::string iterator;
+  int iteratorSlot = -1;
   std::unique_ptr<Instruction> range;
   std::unique_ptr<CodeBlock> code;
+
+  Flow execCounted(std::shared_ptr<Context> ctx, Value::Range counter);
 };
 
-class While : public Instruction {
+class While : public Statement {
  public:
   While(std::unique_ptr<CompareExpr> compare, std::unique_ptr<CodeBlock> code)
       : compare(std::move(compare)), code(std::move(code)) {}
   std::string toString() override;
-  std::shared_ptr<Value> exec(std::shared_ptr<Context> ctx) override;
+  Flow execStatement(std::shared_ptr<Context> ctx) override;
+  void compileStatement(bytecode::Compiler &compiler) override;
+  void declare(FrameLayout &layout) override;
+  void resolve(FrameLayout &layout) override;
+  void optimize(Optimizer &optimizer) override;
 
  private:
   std::unique_ptr<CompareExpr> compare;
@@ -284,14 +540,29 @@ class While : public Instruction {
 class FunctionPointer : public Instruction {
  public:
   FunctionPointer(std::string name, std::vector<std::string> args,
-                  CodeBlock *code_ptr)
-      : name(name), argumentNames(args), code(code_ptr) {}
+                  CodeBlock *code_ptr,
+                  std::shared_ptr<const FrameLayout> layout = nullptr,
+                  std::vector<int> argumentSlots = {},
+                  std::shared_ptr<Context> scope = nullptr)
+      : name(name),
+        argumentNames(args),
+        code(code_ptr),
+        layout(layout),
+        argumentSlots(argumentSlots),
+        scope(scope) {}
   std::shared_ptr<Value> exec(std::shared_ptr<Context> ctx) override;
+  const CodeBlock *getCode() const { return code; }
 
  private:
   CodeBlock *code;
   std::vector<std::string> argumentNames;
   std::string name;
+  std::shared_ptr<const FrameLayout> layout;
+  std::vector<int> argumentSlots;
+  // Context the function was defined in, parent of the call frames. Weak,
+  // because the context owns the function. Function bound in the table of
+  // the scope has none, the caller sets the parent.
+  std::weak_ptr<Context> scope;
 };
 
 #include "Context.h"
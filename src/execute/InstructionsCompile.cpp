@@ -0,0 +1,170 @@
+// Copyright 2019 Kamil Mankowski
+
+#include "Instructions.h"
+
+#include "../bytecode/Compiler.h"
+
+using bytecode::OpCode;
+
+void Instruction::compile(bytecode::Compiler &compiler) {
+  compiler.emit(OpCode::EvalNode, compiler.addNode(this));
+}
+
+void Instruction::compileStatement(bytecode::Compiler &compiler) {
+  compile(compiler);
+  compiler.emit(OpCode::Pop);
+}
+
+void CodeBlock::compileStatement(bytecode::Compiler &compiler) {
+  for (auto &instr : instructions) instr->compileStatement(compiler);
+}
+
+void Function::compileStatement(bytecode::Compiler &compiler) {
+  auto function = compiler.beginFunction(name, argumentNames, layout,
+                                         argumentSlots, this);
+  code->compileStatement(compiler);
+  compiler.endFunction();
+  if (!bound) compiler.emit(OpCode::DefFunction, function);
+}
+
+void Variable::compile(bytecode::Compiler &compiler) {
+  compiler.emitLoad(ref, name);
+}
+
+void Constant::compile(bytecode::Compiler &compiler) {
+  if (value != nullptr) {
+    compiler.emit(OpCode::PushConst, compiler.addConstant(value));
+    return;
+  }
+  for (auto &elem : listElements) elem->compile(compiler);
+  compiler.emit(OpCode::BuildList, listElements.size());
+}
+
+void Slice::compile(bytecode::Compiler &compiler) {
+  source->compile(compiler);
+  auto slice = bytecode::SliceInfo{type, start, end, source->instrName()};
+  compiler.emit(OpCode::Slice, compiler.addSlice(slice));
+}
+
+// Function found by name skips the bound one following it
+void FunctionCall::compileCallee(bytecode::Compiler &compiler) {
+  if (target.function == nullptr || target.byName)
+    compiler.emit(OpCode::LoadFunction, compiler.addName(name),
+                  target.function != nullptr);
+  if (target.function != nullptr)
+    compiler.emit(OpCode::LoadBound, compiler.functionIndex(target.function),
+                  target.depth);
+}
+
+void FunctionCall::compile(bytecode::Compiler &compiler) {
+  compileCallee(compiler);
+  for (auto &arg : args) arg->compile(compiler);
+  compiler.emit(OpCode::Call, args.size());
+}
+
+void FunctionCall::compileTailCall(bytecode::Compiler &compiler) {
+  compileCallee(compiler);
+  for (auto &arg : args) arg->compile(compiler);
+  compiler.emit(OpCode::TailCall, args.size());
+}
+
+void InlinedCall::compile(bytecode::Compiler &compiler) {
+  for (auto &arg : args) arg->compile(compiler);
+  for (int i = parameters.size() - 1; i >= 0; --i)
+    compiler.emitStore(slots[i], parameters[i]);
+  for (auto &statement : statements) statement->compileStatement(compiler);
+  result->compile(compiler);
+  for (std::size_t i = 0; i < renamed.size(); ++i)
+    compiler.emit(OpCode::Unset, renamedSlots[i], compiler.addName(renamed[i]));
+}
+
+// Call of a built-in function leaves the result for Return, call of compiled
+// function replaces the frame and Return is not reached
+void Return::compileStatement(bytecode::Compiler &compiler) {
+  if (tailCall != nullptr)
+    tailCall->compileTailCall(compiler);
+  else
+    value->compile(compiler);
+  compiler.emit(OpCode::Return);
+}
+
+void Expression::compile(bytecode::Compiler &compiler) {
+  args[0]->compile(compiler);
+  for (int i = 0; i < types.size(); ++i) {
+    if (i + 1 >= args.size()) throw UnexpectedError();
+    args[i + 1]->compile(compiler);
+    compiler.emit(OpCode::Binary, types[i]);
+  }
+}
+
+void CompareExpr::compile(bytecode::Compiler &compiler) {
+  leftExpr->compile(compiler);
+  if (type == NoComp) return;
+  rightExpr->compile(compiler);
+  compiler.emit(OpCode::Compare, type);
+}
+
+void AssignExpr::compileStatement(bytecode::Compiler &compiler) {
+  if (type == Type::Assign) {
+    expression->compile(compiler);
+  } else {
+    compiler.emitLoad(VariableRef{0, slot}, variableName);
+    expression->compile(compiler);
+    auto op =
+        type == Type::AddAssign ? Expression::Type::Add : Expression::Type::Sub;
+    compiler.emit(OpCode::Binary, op);
+  }
+  compiler.emitStore(slot, variableName);
+}
+
+void Continue::compileStatement(bytecode::Compiler &compiler) {
+  compiler.emitContinue();
+}
+
+void Break::compileStatement(bytecode::Compiler &compiler) {
+  compiler.emitBreak();
+}
+
+// Comparison and the jump are fused, so the result is never pushed
+std::int32_t CompareExpr::compileCondition(bytecode::Compiler &compiler) {
+  leftExpr->compile(compiler);
+  if (type == NoComp) return compiler.emitJump(OpCode::JumpIfFalse);
+  rightExpr->compile(compiler);
+  return compiler.emitJump(OpCode::CompareJump, type);
+}
+
+void If::compileStatement(bytecode::Compiler &compiler) {
+  auto skip = compare->compileCondition(compiler);
+  ifCode->compileStatement(compiler);
+  compiler.patchJump(skip);
+}
+
+void For::compileStatement(bytecode::Compiler &compiler) {
+  range->compile(compiler);
+  compiler.emit(OpCode::ForStart, compiler.addName(iterator));
+
+  auto next = compiler.position();
+  std::int32_t exit;
+  if (iteratorSlot >= 0) {
+    exit = compiler.emitJump(OpCode::ForNextSlot, iteratorSlot);
+  } else {
+    exit = compiler.emitJump(OpCode::ForNext);
+    compiler.emitStore(iteratorSlot, iterator);
+  }
+  compiler.beginLoop(next);
+  code->compileStatement(compiler);
+  compiler.emit(OpCode::Jump, next);
+  compiler.patchJump(exit);
+  compiler.endLoop();
+  compiler.emit(OpCode::ForEnd);
+}
+
+void While::compileStatement(bytecode::Compiler &compiler) {
+  auto condition = compiler.position();
+  auto exit = compare->compileCondition(compiler);
+  compiler.beginLoop(condition);
+  code->compileStatement(compiler);
+  compiler.emit(OpCode::Jump, condition);
+  compiler.patchJump(exit);
+  compiler.endLoop();
+}
@@ -2,77 +2,122 @@
 
 #include "Instructions.h"
 
-std::shared_ptr<Value> Constant::exec(std::shared_ptr<Context> ctx) {
+#include <array>
+
+void Constant::makeValue() {
   switch (type) {
     case ValueType::None:
-      return std::make_shared<Value>(ValueType::None);
+      value = Value::makeNone();
+      return;
     case ValueType::Int:
-      return std::make_shared<Value>(intValue);
+      value = Value::makeInt(intValue);
+      return;
     case ValueType::Real:
-      return std::make_shared<Value>(realValue);
+      value = std::make_shared<Value>(realValue);
+      return;
     case ValueType::Bool:
-      return std::make_shared<Value>(boolValue);
+      value = Value::makeBool(boolValue);
+      return;
     case ValueType::Text:
-      return std::make_shared<Value>(strValue);
+      value = std::make_shared<Value>(strValue);
+      return;
   }
   std::vector<std::shared_ptr<Value>> values;
   for (auto& elem : listElements) {
-    auto val = elem->exec(ctx);
+    auto val = elem->constantValue();
+    if (val == nullptr) return;
     values.push_back(val);
   }
-  return std::make_shared<Value>(values);
+  value = std::make_shared<Value>(std::move(values));
+}
+
+Constant::Constant(std::shared_ptr<Value> value)
+    : type(value->getType()), value(value) {
+  switch (type) {
+    case ValueType::Int:
+      intValue = value->getInt();
+      break;
+    case ValueType::Real:
+      realValue = value->getReal();
+      break;
+    case ValueType::Bool:
+      boolValue = value->getBool();
+      break;
+    case ValueType::Text:
+      strValue = value->getStr();
+      break;
+  }
+}
+
+std::shared_ptr<Value> Constant::exec(std::shared_ptr<Context> ctx) {
+  if (value != nullptr) return value;
+  std::vector<std::shared_ptr<Value>> values;
+  values.reserve(listElements.size());
+  for (auto& elem : listElements) values.push_back(elem->exec(ctx));
+  return std::make_shared<Value>(std::move(values));
 }
 
 std::shared_ptr<Value> Variable::exec(std::shared_ptr<Context> ctx) {
-  auto val = ctx->getVariableValue(name);
+  auto val = ctx->getVariableValue(ref, name);
   if (val == nullptr) throw ReadNotAssignVariable(name);
   return val;
 }
 
-std::shared_ptr<Value> Return::exec(std::shared_ptr<Context> ctx) {
-  auto retValue = value->exec(ctx);
-  return std::make_shared<Value>(ValueType::T_RETURN, retValue);
+Flow Return::execStatement(std::shared_ptr<Context> ctx) {
+  if (tailCall == nullptr || !tailCall->execTailCall(ctx))
+    ctx->setReturnValue(value->exec(ctx));
+  return Flow::Return;
 }
 
-std::shared_ptr<Value> CodeBlock::exec(std::shared_ptr<Context> ctx) {
-  for (int i = 0; i < instructions.size(); i++) {
-    // if (instructions[i]->getInstructionType() == FunctionT) {
-    //   auto name = instructions[i]->instrName();
-    //   ctx->setFunction(name, std::move(instructions[i]));
-    //   continue;
-    // }
-    auto result = instructions[i]->exec(ctx);
-    if (isResultToReturn(result)) return result;
+Flow CodeBlock::execStatement(std::shared_ptr<Context> ctx) {
+  for (auto& instr : instructions) {
+    auto flow = instr->execStatement(ctx);
+    if (flow != Flow::Normal) return flow;
   }
-  return std::make_shared<Value>(ValueType::None);
-}
-
-bool CodeBlock::isResultToReturn(std::shared_ptr<Value> result) {
-  auto type = result->getType();
-  return type == ValueType::T_BREAK || type == ValueType::T_CONTINUE ||
-         type == ValueType::T_RETURN;
+  return Flow::Normal;
 }
 
 std::shared_ptr<Value> Slice::exec(std::shared_ptr<Context> ctx) {
-  auto sourceValue = source->exec(ctx);
-  if (sourceValue->getType() != ValueType::List)
-    throw NotList(source->instrName());
+  return slice(source->exec(ctx), type, start, end, source->instrName());
+}
 
-  if (start < 0 || start > sourceValue->getList().size())
-    throw OutOfRange(start);
+std::shared_ptr<Value> Slice::slice(std::shared_ptr<Value> sourceValue,
+                                    SliceType type, int start, int end,
+                                    const std::string &sourceName) {
+  if (sourceValue->getType() != ValueType::List) throw NotList(sourceName);
 
-  if (type == SliceType::Start) return sourceValue->getList()[start];
-  if (type == SliceType::StartToEnd) end = sourceValue->getList().size();
-  if (end < 0 || end > sourceValue->getList().size()) throw OutOfRange(end);
+  int size = sourceValue->size();
+  if (start < 0 || start > size) throw OutOfRange(start);
 
-  std::vector<std::shared_ptr<Value>> resultElements;
-  for (int i = start; i < end; ++i)
-    resultElements.push_back(sourceValue->getList()[i]);
-  return std::make_shared<Value>(resultElements);
+  if (type == SliceType::Start) {
+    if (start == size) throw OutOfRange(start);
+    return sourceValue->getElement(start);
+  }
+  if (type == SliceType::StartToEnd) end = size;
+  if (end < 0 || end > size) throw OutOfRange(end);
+
+  if (end < start) end = start;
+  if (sourceValue->isRange()) {
+    auto &range = sourceValue->getRange();
+    return std::make_shared<Value>(
+        Value::Range{range.at(start), range.step, std::size_t(end - start)});
+  }
+  auto &list = sourceValue->getList();
+  std::vector<std::shared_ptr<Value>> resultElements(list.begin() + start,
+                                                     list.begin() + end);
+  return std::make_shared<Value>(std::move(resultElements));
 }
 
 std::shared_ptr<Value> FunctionCall::exec(std::shared_ptr<Context> ctx) {
-  auto func = ctx->getFunction(name);
+  std::shared_ptr<Instruction> func = nullptr;
+  if (target.function == nullptr || target.byName)
+    func = ctx->getFunction(name);
+  if (func == nullptr && target.function != nullptr) {
+    auto callctx =
+        std::make_shared<Context>(Context::enclosing(ctx, target.depth));
+    for (auto& arg : args) callctx->addParameter(arg->exec(ctx));
+    return target.function->getPointer().exec(callctx);
+  }
   if (func == nullptr) throw FunctionNotDeclared(name);
 
   auto callctx = std::make_shared<Context>(ctx);
@@ -84,139 +129,217 @@ std::shared_ptr<Value> FunctionCall::exec(std::shared_ptr<Context> ctx) {
   return func->exec(callctx);
 }
 
-std::map<ValueType, std::map<Expression::Type, std::vector<ValueType>>>
-    Expression::allowedOperands = {
-        {ValueType::List,
-         std::map<Expression::Type, std::vector<ValueType>>{
-             {Expression::Type::Add, {ValueType::List}},
-             {Expression::Type::Sub, {}},
-             {Expression::Type::Mul, {ValueType::Int}},
-             {Expression::Type::Div, {}},
-             {Expression::Type::Exp, {}},
-         }},
-        {ValueType::Text,
-         std::map<Expression::Type, std::vector<ValueType>>{
-             {Expression::Type::Add, {ValueType::Text}},
-             {Expression::Type::Sub, {}},
-             {Expression::Type::Mul, {ValueType::Int}},
-             {Expression::Type::Div, {}},
-             {Expression::Type::Exp, {}},
-         }},
-        {ValueType::Int,
-         std::map<Expression::Type, std::vector<ValueType>>{
-             {Expression::Type::Add, {ValueType::Int, ValueType::Real}},
-             {Expression::Type::Sub, {ValueType::Int, ValueType::Real}},
-             {Expression::Type::Mul,
-              {ValueType::Int, ValueType::Real, ValueType::List}},
-             {Expression::Type::Div, {ValueType::Int, ValueType::Real}},
-             {Expression::Type::Exp, {ValueType::Int, ValueType::Real}},
-         }},
-        {ValueType::Real,
-         std::map<Expression::Type, std::vector<ValueType>>{
-             {Expression::Type::Add, {ValueType::Int, ValueType::Real}},
-             {Expression::Type::Sub, {ValueType::Int, ValueType::Real}},
-             {Expression::Type::Mul, {ValueType::Int, ValueType::Real}},
-             {Expression::Type::Div, {ValueType::Int, ValueType::Real}},
-             {Expression::Type::Exp, {ValueType::Int, ValueType::Real}},
-         }},
-};
+bool FunctionCall::execTailCall(std::shared_ptr<Context> ctx) {
+  Instruction *func = nullptr;
+  if (target.function == nullptr || target.byName)
+    func = ctx->getFunction(name).get();
+  if (func == nullptr && target.function != nullptr)
+    func = &target.function->getPointer();
+  if (func == nullptr) throw FunctionNotDeclared(name);
+  if (func != ctx->getExecutedFunction()) return false;
 
-bool Expression::checkCompatibility(ValueType left, ValueType right,
-                                    Expression::Type op) {
-  if (left == ValueType::None) return false;
-  auto findRight = std::find(allowedOperands[left][op].begin(),
-                             allowedOperands[left][op].end(), right);
-  return findRight != allowedOperands[left][op].end();
+  std::vector<std::shared_ptr<Value>> arguments;
+  arguments.reserve(args.size());
+  for (auto& arg : args) arguments.push_back(arg->exec(ctx));
+  ctx->setTailCall(std::move(arguments));
+  return true;
 }
 
-std::shared_ptr<Value> Expression::execExprList(std::shared_ptr<Value> list,
-                                                std::shared_ptr<Value> right,
-                                                Type op) {
-  std::vector<std::shared_ptr<Value>> elements;
-  if (op == Type::Mul) {
-    for (int i = 0; i < right->getInt(); ++i) {
-      for (auto& elem : list->getList())
-        elements.push_back(std::make_shared<Value>(*elem));
-    }
-  } else {
-    for (auto& elem : list->getList())
-      elements.push_back(std::make_shared<Value>(*elem));
-    for (auto& elem : right->getList())
-      elements.push_back(std::make_shared<Value>(*elem));
+// Arguments are computed before any parameter is set, as one of them can be
+// the same function inlined
+std::shared_ptr<Value> InlinedCall::exec(std::shared_ptr<Context> ctx) {
+  std::vector<std::shared_ptr<Value>> values;
+  values.reserve(args.size());
+  for (auto& arg : args) values.push_back(arg->exec(ctx));
+  for (std::size_t i = 0; i < values.size(); ++i)
+    ctx->setVariable(slots[i], parameters[i], std::move(values[i]));
+
+  for (auto& statement : statements) statement->execStatement(ctx);
+  auto value = result->exec(ctx);
+  for (std::size_t i = 0; i < renamed.size(); ++i)
+    ctx->setVariable(renamedSlots[i], renamed[i], nullptr);
+  return value;
+}
+
+namespace {
+
+// Kernels for each combination of operand types and operator are generated
+// at compile time. Types without a kernel are not compatible.
+using Kernel = Expression::Kernel;
+
+constexpr std::size_t typesCount =
+    static_cast<std::size_t>(ValueType::List) + 1;
+constexpr std::size_t operatorsCount =
+    static_cast<std::size_t>(Expression::Type::Exp) + 1;
+
+template <typename T>
+T arithmetic(T left, T right, Expression::Type op) {
+  switch (op) {
+    case Expression::Type::Add:
+      return left + right;
+    case Expression::Type::Sub:
+      return left - right;
+    case Expression::Type::Mul:
+      return left * right;
+    case Expression::Type::Div:
+      return left / right;
+    default:
+      return static_cast<T>(std::pow(left, right));
   }
+}
 
-  return std::make_shared<Value>(elements);
+template <ValueType type>
+double toReal(Value& val) {
+  return type == ValueType::Int ? val.getInt() : val.getReal();
 }
 
-std::shared_ptr<Value> Expression::execExprStr(std::shared_ptr<Value> str,
-                                               std::shared_ptr<Value> right,
-                                               Type op) {
-  std::string out = "";
-  if (op == Type::Mul) {
-    for (int i = 0; i < right->getInt(); ++i) out += str->getStr();
-  } else {
-    out = str->getStr() + right->getStr();
-  }
+template <Expression::Type op>
+std::shared_ptr<Value> intKernel(Value& left, Value& right) {
+  return Value::makeInt(arithmetic(left.getInt(), right.getInt(), op));
+}
 
-  return std::make_shared<Value>(out);
+template <ValueType leftType, ValueType rightType, Expression::Type op>
+std::shared_ptr<Value> realKernel(Value& left, Value& right) {
+  return std::make_shared<Value>(arithmetic(toReal<leftType>(left),
+                                            toReal<rightType>(right), op));
 }
 
-std::shared_ptr<Value> Expression::execExprInt(int64_t left, int64_t right,
-                                               Type op) {
-  if (op == Expression::Type::Add) return std::make_shared<Value>(left + right);
-  if (op == Expression::Type::Sub) return std::make_shared<Value>(left - right);
-  if (op == Expression::Type::Mul) return std::make_shared<Value>(left * right);
-  if (op == Expression::Type::Div) return std::make_shared<Value>(left / right);
-  return std::make_shared<Value>((int64_t)std::pow(left, right));
+std::shared_ptr<Value> concatText(Value& left, Value& right) {
+  auto& leftStr = left.getStr();
+  auto& rightStr = right.getStr();
+  std::string out;
+  out.reserve(leftStr.size() + rightStr.size());
+  out += leftStr;
+  out += rightStr;
+  return std::make_shared<Value>(std::move(out));
 }
 
-std::shared_ptr<Value> Expression::execExprReal(double left, double right,
-                                                Type op) {
-  if (op == Expression::Type::Add) return std::make_shared<Value>(left + right);
-  if (op == Expression::Type::Sub) return std::make_shared<Value>(left - right);
-  if (op == Expression::Type::Mul) return std::make_shared<Value>(left * right);
-  if (op == Expression::Type::Div) return std::make_shared<Value>(left / right);
-  return std::make_shared<Value>(std::pow(left, right));
+std::shared_ptr<Value> repeatText(Value& text, Value& times) {
+  auto& source = text.getStr();
+  auto count = times.getInt();
+  std::string out;
+  if (count > 0) out.reserve(source.size() * count);
+  for (int i = 0; i < count; ++i) out += source;
+  return std::make_shared<Value>(std::move(out));
 }
 
-std::shared_ptr<Value> Expression::makeExpression(std::shared_ptr<Value> left,
-                                                  std::shared_ptr<Value> right,
-                                                  Expression::Type op) {
-  auto leftType = left->getType();
-  auto rightType = right->getType();
+// Elements are never changed in place, so the result shares them
+std::shared_ptr<Value> concatList(Value& left, Value& right) {
+  auto& leftList = left.getList();
+  auto& rightList = right.getList();
+  std::vector<std::shared_ptr<Value>> elements;
+  elements.reserve(leftList.size() + rightList.size());
+  elements.insert(elements.end(), leftList.begin(), leftList.end());
+  elements.insert(elements.end(), rightList.begin(), rightList.end());
+  return std::make_shared<Value>(std::move(elements));
+}
 
-  if (leftType == ValueType::List || rightType == ValueType::List) {
-    if (leftType == ValueType::List)
-      return execExprList(left, right, op);
-    else
-      return execExprList(right, left, op);
-  }
-  if (leftType == ValueType::Text || rightType == ValueType::Text) {
-    if (leftType == ValueType::Text)
-      return execExprStr(left, right, op);
-    else
-      return execExprStr(right, left, op);
-  }
-  if (leftType == ValueType::Real || rightType == ValueType::Real) {
-    if (leftType == ValueType::Int) left->setReal(left->getInt());
-    if (rightType == ValueType::Int) right->setReal(right->getInt());
-    return execExprReal(left->getReal(), right->getReal(), op);
+std::shared_ptr<Value> repeatList(Value& list, Value& times) {
+  auto& source = list.getList();
+  auto count = times.getInt();
+  std::vector<std::shared_ptr<Value>> elements;
+  if (count > 0) elements.reserve(source.size() * count);
+  for (int i = 0; i < count; ++i)
+    elements.insert(elements.end(), source.begin(), source.end());
+  return std::make_shared<Value>(std::move(elements));
+}
+
+std::shared_ptr<Value> repeatListRight(Value& times, Value& list) {
+  return repeatList(list, times);
+}
+
+constexpr bool isNumber(ValueType type) {
+  return type == ValueType::Int || type == ValueType::Real;
+}
+
+template <ValueType left, ValueType right, Expression::Type op>
+constexpr Kernel selectKernel() {
+  using T = ValueType;
+  using E = Expression::Type;
+  return op == E::None ? nullptr
+         : left == T::Int && right == T::Int ? &intKernel<op>
+         : isNumber(left) && isNumber(right) ? &realKernel<left, right, op>
+         : left == T::Text && right == T::Text && op == E::Add ? &concatText
+         : left == T::Text && right == T::Int && op == E::Mul ? &repeatText
+         : left == T::List && right == T::List && op == E::Add ? &concatList
+         : left == T::List && right == T::Int && op == E::Mul ? &repeatList
+         : left == T::Int && right == T::List && op == E::Mul ? &repeatListRight
+         : nullptr;
+}
+
+// Kernel of (left, right, op) is at (left * typesCount + right) *
+// operatorsCount + op
+template <std::size_t... I>
+constexpr std::array<Kernel, sizeof...(I)> makeKernels(
+    std::index_sequence<I...>) {
+  using T = ValueType;
+  using E = Expression::Type;
+  return {{selectKernel<static_cast<T>(I / operatorsCount / typesCount),
+                        static_cast<T>(I / operatorsCount % typesCount),
+                        static_cast<E>(I % operatorsCount)>()...}};
+}
+
+constexpr auto kernels = makeKernels(
+    std::make_index_sequence<typesCount * typesCount * operatorsCount>());
+
+}  // namespace
+
+Expression::Kernel Expression::findKernel(ValueType left, ValueType right,
+                                          Expression::Type op) {
+  auto leftIndex = static_cast<std::size_t>(left);
+  auto rightIndex = static_cast<std::size_t>(right);
+  return kernels[(leftIndex * typesCount + rightIndex) * operatorsCount +
+                 static_cast<std::size_t>(op)];
+}
+
+std::shared_ptr<Value> Expression::evaluate(const std::shared_ptr<Value>& left,
+                                            const std::shared_ptr<Value>& right,
+                                            Expression::Type op) {
+  auto kernel = findKernel(left->getType(), right->getType(), op);
+  if (kernel == nullptr)
+    throw OperandsTypesNotCompatible("", "", typeToString(op));
+  return kernel(*left, *right);
+}
+
+std::shared_ptr<Value> Expression::Site::evaluate(
+    const std::shared_ptr<Value>& left, const std::shared_ptr<Value>& right,
+    Expression::Type op) {
+  if (kernel != nullptr && left->getType() == leftType &&
+      right->getType() == rightType)
+    return kernel(*left, *right);
+  if (generic) return Expression::evaluate(left, right, op);
+
+  // First types are cached, other types make the site generic
+  if (kernel == nullptr) {
+    kernel = findKernel(left->getType(), right->getType(), op);
+    leftType = left->getType();
+    rightType = right->getType();
+  } else {
+    kernel = nullptr;
+    generic = true;
   }
-  return execExprInt(left->getInt(), right->getInt(), op);
+  return Expression::evaluate(left, right, op);
 }
 
-std::shared_ptr<Value> Expression::exec(std::shared_ptr<Context> ctx) {
-  auto left = args[0]->exec(ctx);
-  int i = 1;
-  for (auto op : types) {
-    if (i >= args.size()) throw UnexpectedError();
-    auto right = args[i]->exec(ctx);
+std::unique_ptr<Instruction> Expression::flatten(
+    std::unique_ptr<Instruction> instr) {
+  auto expr = dynamic_cast<Expression *>(instr.get());
+  if (expr == nullptr || !expr->types.empty() || expr->args.size() != 1)
+    return instr;
+  return std::move(expr->args[0]);
+}
 
-    if (!checkCompatibility(left->getType(), right->getType(), op))
-      throw OperandsTypesNotCompatible("", "", Expression::typeToString(op));
+std::shared_ptr<Value> Expression::constantValue() {
+  if (!types.empty() || args.size() != 1) return nullptr;
+  return args[0]->constantValue();
+}
 
-    left = makeExpression(left, right, op);
-    ++i;
+std::shared_ptr<Value> Expression::exec(std::shared_ptr<Context> ctx) {
+  auto left = args[0]->exec(ctx);
+  if (args.size() <= types.size()) throw UnexpectedError();
+  for (std::size_t i = 0; i < types.size(); ++i) {
+    auto right = args[i + 1]->exec(ctx);
+    left = sites[i].evaluate(left, right, types[i]);
   }
   return left;
 }
@@ -224,39 +347,61 @@ std::shared_ptr<Value> Expression::exec(std::shared_ptr<Context> ctx) {
 std::shared_ptr<Value> AssignExpr::exec(std::shared_ptr<Context> ctx) {
   if (type == Type::Assign) {
     auto value = expression->exec(ctx);
-    ctx->setVariable(variableName, value);
+    ctx->setVariable(slot, variableName, value);
     return value;
   } else {
-    auto old = ctx->getVariableValue(variableName);
+    auto old = ctx->getVariableValue(slot, variableName);
     if (old == nullptr) throw ReadNotAssignVariable(variableName);
 
     auto value = expression->exec(ctx);
+    // List referenced only by the variable (and `old`) is not seen by any
+    // other name, so `+=` appends to it in place
+    if (type == Type::AddAssign && old.use_count() == 2 &&
+        old->getType() == ValueType::List &&
+        value->getType() == ValueType::List) {
+      auto &right = value->getList();
+      auto &elements = old->getMutableList();
+      elements.insert(elements.end(), right.begin(), right.end());
+      return old;
+    }
     auto op =
         type == Type::AddAssign ? Expression::Type::Add : Expression::Type::Sub;
 
-    if (!Expression::checkCompatibility(old->getType(), value->getType(), op))
-      throw OperandsTypesNotCompatible("", "", Expression::typeToString(op));
-
-    auto newvalue = Expression::makeExpression(old, value, op);
-    ctx->setVariable(variableName, newvalue);
+    auto newvalue = site.evaluate(old, value, op);
+    ctx->setVariable(slot, variableName, newvalue);
     return newvalue;
   }
 }
 
-std::shared_ptr<Value> For::exec(std::shared_ptr<Context> ctx) {
+Flow For::execStatement(std::shared_ptr<Context> ctx) {
   auto rangeList = range->exec(ctx);
   if (rangeList->getType() != ValueType::List) throw IterableExpected();
+  if (rangeList->isRange()) return execCounted(ctx, rangeList->getRange());
+
+  // Script cannot change the list, so its elements are iterated in place.
+  // The value is kept alive by rangeList even if the variable is rebound.
+  auto size = rangeList->size();
+  for (std::size_t i = 0; i < size; ++i) {
+    ctx->setVariable(iteratorSlot, iterator, rangeList->getElement(i));
+    auto flow = code->execStatement(ctx);
+    if (flow == Flow::Break) break;
+    if (flow == Flow::Return) return flow;
+  }
+
+  return Flow::Normal;
+}
 
-  std::shared_ptr<Value> result;
-  for (auto value : rangeList->getList()) {
-    ctx->setVariable(iterator, value);
-    result = code->exec(ctx);
-    if (result->getType() == ValueType::T_BREAK) break;
-    if (result->getType() == ValueType::T_CONTINUE) continue;
-    if (result->getType() == ValueType::T_RETURN) return result;
+// Loop over range() runs on native integers, without creating elements
+Flow For::execCounted(std::shared_ptr<Context> ctx, Value::Range counter) {
+  std::shared_ptr<Value> iteratorValue;
+  for (std::size_t i = 0; i < counter.length; ++i) {
+    ctx->setCounter(iteratorSlot, iterator, iteratorValue, counter.at(i));
+    auto flow = code->execStatement(ctx);
+    if (flow == Flow::Break) break;
+    if (flow == Flow::Return) return flow;
   }
 
-  return std::make_shared<Value>(ValueType::None);
+  return Flow::Normal;
 }
 
 bool CompareExpr::checkTypeCompatibility(ValueType left, ValueType right) {
@@ -268,8 +413,8 @@ bool CompareExpr::checkTypeCompatibility(ValueType left, ValueType right) {
   return true;
 }
 
-bool CompareExpr::checkEqual(std::shared_ptr<Value> left,
-                             std::shared_ptr<Value> right) {
+bool CompareExpr::checkEqual(const std::shared_ptr<Value>& left,
+                             const std::shared_ptr<Value>& right) {
   auto leftType = left->getType();
   auto rightType = right->getType();
 
@@ -298,20 +443,25 @@ bool CompareExpr::checkEqual(std::shared_ptr<Value> left,
   throw UnexpectedError();
 }
 
-bool CompareExpr::checkEqualList(std::shared_ptr<Value> left,
-                                 std::shared_ptr<Value> right) {
-  auto leftList = left->getList();
-  auto rightList = right->getList();
-
-  if (leftList.size() != rightList.size()) return false;
-  for (int i = 0; i < leftList.size(); ++i) {
-    if (!checkEqual(leftList[i], rightList[i])) return false;
+bool CompareExpr::checkEqualList(const std::shared_ptr<Value>& left,
+                                 const std::shared_ptr<Value>& right) {
+  auto size = left->size();
+  if (size != right->size()) return false;
+  if (left->isRange() && right->isRange()) {
+    auto& leftRange = left->getRange();
+    auto& rightRange = right->getRange();
+    return size == 0 || leftRange.start == rightRange.start &&
+                            (size == 1 || leftRange.step == rightRange.step);
+  }
+  for (std::size_t i = 0; i < size; ++i) {
+    if (!checkEqual(left->getElement(i), right->getElement(i))) return false;
   }
   return true;
 }
 
 template <typename T>
-bool CompareExpr::compare(T left, T right, CompareExpr::Type cmp) {
+bool CompareExpr::compare(const T& left, const T& right,
+                          CompareExpr::Type cmp) {
   switch (cmp) {
     case Less:
       return left < right;
@@ -321,12 +471,17 @@ bool CompareExpr::compare(T left, T right, CompareExpr::Type cmp) {
       return left > right;
     case GreaterEq:
       return left >= right;
+    case Different:
+      return left != right;
+    case Equal:
+      return left == right;
   }
   throw UnexpectedError();
 }
 
-bool CompareExpr::compare(std::shared_ptr<Value> left,
-                          std::shared_ptr<Value> right, CompareExpr::Type cmp) {
+bool CompareExpr::compare(const std::shared_ptr<Value>& left,
+                          const std::shared_ptr<Value>& right,
+                          CompareExpr::Type cmp) {
   if (!checkTypeCompatibility(left->getType(), right->getType()) ||
       left->getType() == ValueType::None || left->getType() == ValueType::Bool)
     throw TypesNotComparable();
@@ -349,38 +504,73 @@ bool CompareExpr::compare(std::shared_ptr<Value> left,
   throw UnexpectedError();
 }
 
-bool CompareExpr::compareList(std::shared_ptr<Value> left,
-                              std::shared_ptr<Value> right,
+bool CompareExpr::compareList(const std::shared_ptr<Value>& left,
+                              const std::shared_ptr<Value>& right,
                               CompareExpr::Type cmp) {
-  auto leftList = left->getList();
-  auto rightList = right->getList();
+  auto leftSize = left->size();
+  auto rightSize = right->size();
 
-  for (int i = 0; i < leftList.size(); ++i) {
-    if (i < rightList.size()) {
-      if (!compare(leftList[i], rightList[i], cmp)) return false;
+  for (std::size_t i = 0; i < leftSize; ++i) {
+    if (i < rightSize) {
+      if (!compare(left->getElement(i), right->getElement(i), cmp))
+        return false;
     } else {
-      return compare<int>(leftList.size(), rightList.size(), cmp);
+      return compare<std::size_t>(leftSize, rightSize, cmp);
     }
   }
   return true;
 }
 
-std::shared_ptr<Value> CompareExpr::exec(std::shared_ptr<Context> ctx) {
-  switch (type) {
-    case NoComp:
-      return leftExpr->exec(ctx);
+bool CompareExpr::evaluate(std::shared_ptr<Value> left,
+                           std::shared_ptr<Value> right,
+                           CompareExpr::Type cmp) {
+  switch (cmp) {
     case Equal:
-      return std::make_shared<Value>(
-          checkEqual(leftExpr->exec(ctx), rightExpr->exec(ctx)));
+      return checkEqual(left, right);
     case Different:
-      return std::make_shared<Value>(
-          !checkEqual(leftExpr->exec(ctx), rightExpr->exec(ctx)));
+      return !checkEqual(left, right);
     default:
-      return std::make_shared<Value>(
-          compare(leftExpr->exec(ctx), rightExpr->exec(ctx), type));
+      return compare(left, right, cmp);
   }
 }
 
+std::shared_ptr<Value> CompareExpr::exec(std::shared_ptr<Context> ctx) {
+  if (type == NoComp) return leftExpr->exec(ctx);
+  auto left = leftExpr->exec(ctx);
+  auto right = rightExpr->exec(ctx);
+  return Value::makeBool(evaluateSpecialized(left, right));
+}
+
+bool CompareExpr::isTrue(std::shared_ptr<Context> ctx) {
+  if (type == NoComp) return !isFalseEquivalent(leftExpr->exec(ctx));
+  auto left = leftExpr->exec(ctx);
+  auto right = rightExpr->exec(ctx);
+  return evaluateSpecialized(left, right);
+}
+
+bool CompareExpr::evaluateSpecialized(const std::shared_ptr<Value>& left,
+                                      const std::shared_ptr<Value>& right) {
+  auto leftType = left->getType();
+  if (leftType == right->getType()) {
+    if (feedback == Feedback::Int && leftType == ValueType::Int)
+      return compare<int64_t>(left->getInt(), right->getInt(), type);
+    if (feedback == Feedback::Real && leftType == ValueType::Real)
+      return compare<double>(left->getReal(), right->getReal(), type);
+    if (feedback == Feedback::Text && leftType == ValueType::Text)
+      return compare<std::string>(left->getStr(), right->getStr(), type);
+  }
+
+  // First types are recorded, other types make the comparison generic
+  auto observed = Feedback::Generic;
+  if (leftType == right->getType()) {
+    if (leftType == ValueType::Int) observed = Feedback::Int;
+    if (leftType == ValueType::Real) observed = Feedback::Real;
+    if (leftType == ValueType::Text) observed = Feedback::Text;
+  }
+  feedback = feedback == Feedback::Unset ? observed : Feedback::Generic;
+  return evaluate(left, right, type);
+}
+
 bool CompareExpr::isFalseEquivalent(std::shared_ptr<Value> val) {
   switch (val->getType()) {
     case ValueType::Bool:
@@ -390,49 +580,84 @@ bool CompareExpr::isFalseEquivalent(std::shared_ptr<Value> val) {
     case ValueType::Real:
       return val->getReal() == 0.0;
     case ValueType::List:
-      return val->getList().size() == 0;
     case ValueType::Text:
-      return val->getStr() == "";
+      return val->size() == 0;
     case ValueType::None:
       return true;
   }
   throw UnexpectedError();
 }
 
-std::shared_ptr<Value> If::exec(std::shared_ptr<Context> ctx) {
-  auto cmpResult = compare->exec(ctx);
-  if (CompareExpr::isFalseEquivalent(cmpResult))
-    return std::make_shared<Value>(ValueType::None);
-  return ifCode->exec(ctx);
+Flow If::execStatement(std::shared_ptr<Context> ctx) {
+  if (!compare->isTrue(ctx)) return Flow::Normal;
+  return ifCode->execStatement(ctx);
 }
 
-std::shared_ptr<Value> While::exec(std::shared_ptr<Context> ctx) {
-  auto cmpResult = compare->exec(ctx);
-  while (!CompareExpr::isFalseEquivalent(cmpResult)) {
-    auto result = code->exec(ctx);
-    if (result->getType() == ValueType::T_BREAK) break;
-    if (result->getType() == ValueType::T_RETURN) return result;
-    cmpResult = compare->exec(ctx);
-    // if (result->getType() == ValueType::T_CONTINUE) continue;
+Flow While::execStatement(std::shared_ptr<Context> ctx) {
+  while (compare->isTrue(ctx)) {
+    auto flow = code->execStatement(ctx);
+    if (flow == Flow::Break) break;
+    if (flow == Flow::Return) return flow;
   }
-  return std::make_shared<Value>(ValueType::None);
+  return Flow::Normal;
 }
 
-std::shared_ptr<Value> Function::exec(std::shared_ptr<Context> ctx) {
-  auto funcPtr =
-      std::make_shared<FunctionPointer>(name, argumentNames, code.get());
+// Definition executed again in the same context (in a loop) keeps the
+// function it has defined before
+Flow Function::execStatement(std::shared_ptr<Context> ctx) {
+  if (bound) return Flow::Normal;
+  auto defined =
+      dynamic_cast<FunctionPointer *>(ctx->getOwnFunction(name).get());
+  if (defined != nullptr && defined->getCode() == code.get())
+    return Flow::Normal;
+
+  auto funcPtr = std::make_shared<FunctionPointer>(
+      name, argumentNames, code.get(), layout, argumentSlots, ctx);
   ctx->setFunction(name, funcPtr);
-  return std::make_shared<Value>(ValueType::None);
+  return Flow::Normal;
 }
 
+namespace {
+
+// Counts the call in the global context while the function is executed
+class CallDepthGuard {
+ public:
+  explicit CallDepthGuard(Context &global) : global(global) {
+    global.enterCall();
+  }
+  ~CallDepthGuard() { global.leaveCall(); }
+
+ private:
+  Context &global;
+};
+
+}  // namespace
+
+// Self call in tail position is executed by the loop in a new context. Each
+// context after the first is released by the next iteration (the first one
+// is kept by the caller), so the recursion runs in constant memory and
+// native stack.
 std::shared_ptr<Value> FunctionPointer::exec(std::shared_ptr<Context> ctx) {
-  if (ctx->parametersSize() != argumentNames.size())
-    throw ParametersCountNotExpected(name, ctx->parametersSize(),
-                                     argumentNames.size());
-  for (int i = 0; i < ctx->parametersSize(); ++i)
-    ctx->setVariable(argumentNames[i], ctx->getParameter(i));
-
-  auto result = code->exec(ctx);
-  if (result->getType() == ValueType::T_RETURN) return result->getValuePtr();
-  return std::make_shared<Value>(ValueType::None);
+  auto definitionCtx = scope.lock();
+  CallDepthGuard depthGuard(ctx->getGlobal());
+  while (true) {
+    if (ctx->parametersSize() != argumentNames.size())
+      throw ParametersCountNotExpected(name, ctx->parametersSize(),
+                                       argumentNames.size());
+    if (definitionCtx != nullptr) ctx->setParent(definitionCtx);
+    ctx->setLayout(layout);
+    ctx->setExecutedFunction(this);
+    for (std::size_t i = 0; i < ctx->parametersSize(); ++i) {
+      int slot = i < argumentSlots.size() ? argumentSlots[i] : -1;
+      ctx->setVariable(slot, argumentNames[i], ctx->getParameter(i));
+    }
+
+    if (code->execStatement(ctx) != Flow::Return) return Value::makeNone();
+    if (!ctx->hasTailCall()) return ctx->takeReturnValue();
+
+    auto callctx = std::make_shared<Context>(ctx->getParent());
+    for (auto& argument : ctx->takeTailCall())
+      callctx->addParameter(std::move(argument));
+    ctx = std::move(callctx);
+  }
 }
@@ -0,0 +1,238 @@
+// Copyright 2019 Kamil Mankowski
+
+#include "Instructions.h"
+
+#include "Optimizer.h"
+
+// Optimization pass works on the tree straight from the parser. Children
+// are optimized first, so constant operands are already folded when the
+// parent looks at them. Expressions left with a single operand are replaced
+// by the operand and inlined calls by the body, see Optimizer::optimize().
+
+void CodeBlock::optimize(Optimizer &optimizer) {
+  optimizer.enterBlock();
+  for (auto &instr : instructions) optimizer.optimize(instr);
+  optimizer.leaveBlock();
+}
+
+void Function::optimize(Optimizer &optimizer) {
+  if (code != nullptr) code->optimize(optimizer);
+  optimizer.defineFunction(*this);
+}
+
+void Constant::optimize(Optimizer &optimizer) {
+  for (auto &elem : listElements) optimizer.optimize(elem);
+  if (value == nullptr) makeValue();
+}
+
+void Slice::optimize(Optimizer &optimizer) { optimizer.optimize(source); }
+
+void FunctionCall::optimize(Optimizer &optimizer) {
+  for (auto &arg : args) optimizer.optimize(arg);
+}
+
+void Return::optimize(Optimizer &optimizer) { optimizer.optimize(value); }
+
+bool Expression::isNumber(Instruction &instr) {
+  auto value = instr.constantValue();
+  if (value != nullptr)
+    return value->getType() == ValueType::Int ||
+           value->getType() == ValueType::Real;
+  auto expr = dynamic_cast<Expression *>(&instr);
+  return expr != nullptr && expr->numeric;
+}
+
+namespace {
+
+// x + 0, x - 0, x * 1, x / 1 and x ^ 1 give x when it is a number
+bool isIdentity(Expression::Type op, const std::shared_ptr<Value> &right) {
+  if (right == nullptr || right->getType() != ValueType::Int) return false;
+  if (op == Expression::Type::Add || op == Expression::Type::Sub)
+    return right->getInt() == 0;
+  return right->getInt() == 1;
+}
+
+}  // namespace
+
+// Operations are applied from left to right, so only the leading constant
+// operands can be folded. Operation which does not change the number is
+// dropped when the type of the left side is known.
+void Expression::optimize(Optimizer &optimizer) {
+  for (auto &arg : args) optimizer.optimize(arg);
+  if (args.size() != types.size() + 1) return;
+  auto before = optimizer.logging() ? toString() : "";
+
+  std::vector<std::unique_ptr<Instruction>> keptArgs;
+  std::vector<Type> keptTypes;
+  keptArgs.push_back(std::move(args[0]));
+  bool leftNumeric = isNumber(*keptArgs[0]);
+  bool folded = false;
+
+  for (std::size_t i = 0; i < types.size(); ++i) {
+    auto op = types[i];
+    auto &right = args[i + 1];
+    auto rightValue = right->constantValue();
+    auto leftValue = keptTypes.empty() ? keptArgs[0]->constantValue() : nullptr;
+    if (leftValue != nullptr && rightValue != nullptr) {
+      auto result = Optimizer::foldOperation(leftValue, rightValue, op);
+      if (result != nullptr) {
+        keptArgs[0] = std::make_unique<Constant>(result);
+        leftNumeric = isNumber(*keptArgs[0]);
+        folded = true;
+        continue;
+      }
+    }
+    if (leftNumeric && isIdentity(op, rightValue)) {
+      folded = true;
+      continue;
+    }
+
+    // Sub, Div and Exp accept only numbers, Add of number needs a number
+    if (op == Type::Sub || op == Type::Div || op == Type::Exp)
+      leftNumeric = true;
+    else if (op == Type::Add)
+      leftNumeric = leftNumeric || isNumber(*right);
+    else
+      leftNumeric = leftNumeric && isNumber(*right);
+    keptArgs.push_back(std::move(right));
+    keptTypes.push_back(op);
+  }
+
+  args = std::move(keptArgs);
+  types = std::move(keptTypes);
+  sites.assign(types.size(), Site());
+  numeric = leftNumeric;
+  if (folded) optimizer.report(before, toString());
+}
+
+void CompareExpr::optimize(Optimizer &optimizer) {
+  optimizer.optimize(leftExpr);
+  if (rightExpr == nullptr) return;
+  optimizer.optimize(rightExpr);
+
+  auto left = leftExpr->constantValue();
+  auto right = rightExpr->constantValue();
+  if (left == nullptr || right == nullptr) return;
+  auto result = Optimizer::foldCompare(left, right, type);
+  if (result == nullptr) return;
+
+  auto before = optimizer.logging() ? toString() : "";
+  leftExpr = std::make_unique<Constant>(result);
+  rightExpr = nullptr;
+  type = NoComp;
+  optimizer.report(before, toString());
+}
+
+void AssignExpr::optimize(Optimizer &optimizer) {
+  optimizer.optimize(expression);
+}
+
+void If::optimize(Optimizer &optimizer) {
+  compare->optimize(optimizer);
+  ifCode->optimize(optimizer);
+}
+
+void For::optimize(Optimizer &optimizer) {
+  optimizer.optimize(range);
+  code->optimize(optimizer);
+}
+
+void While::optimize(Optimizer &optimizer) {
+  compare->optimize(optimizer);
+  code->optimize(optimizer);
+}
+
+// Copies made for inlining. Variables are renamed, so the body does not
+// collide with variables of the scope it is inlined into.
+
+std::unique_ptr<Instruction> Variable::inlineCopy(Optimizer &optimizer) {
+  auto renamed = optimizer.renamedVariable(name);
+  if (renamed.empty() || !optimizer.countNode()) return nullptr;
+  return std::make_unique<Variable>(renamed);
+}
+
+std::unique_ptr<Instruction> Constant::inlineCopy(Optimizer &optimizer) {
+  if (!optimizer.countNode()) return nullptr;
+  if (value != nullptr) return std::make_unique<Constant>(value);
+
+  std::vector<std::unique_ptr<Instruction>> elements;
+  for (auto &elem : listElements) {
+    auto copy = elem->inlineCopy(optimizer);
+    if (copy == nullptr) return nullptr;
+    elements.push_back(std::move(copy));
+  }
+  return std::make_unique<Constant>(std::move(elements));
+}
+
+std::unique_ptr<Instruction> Slice::inlineCopy(Optimizer &optimizer) {
+  auto sourceCopy = source->inlineCopy(optimizer);
+  if (sourceCopy == nullptr || !optimizer.countNode()) return nullptr;
+  auto copy = std::make_unique<Slice>(type, start, end);
+  copy->setSource(std::move(sourceCopy));
+  return std::move(copy);
+}
+
+// Only built-in functions can be called, the user defined could be recursive
+std::unique_ptr<Instruction> FunctionCall::inlineCopy(Optimizer &optimizer) {
+  if (optimizer.isUserFunction(name) || !optimizer.countNode()) return nullptr;
+  auto copy = std::make_unique<FunctionCall>(name);
+  for (auto &arg : args) {
+    auto argCopy = arg->inlineCopy(optimizer);
+    if (argCopy == nullptr) return nullptr;
+    copy->addArgument(std::move(argCopy));
+  }
+  return std::move(copy);
+}
+
+std::unique_ptr<Instruction> FunctionCall::inlineCall(Optimizer &optimizer) {
+  auto body = optimizer.inlinedBody(name, args.size());
+  if (body == nullptr) return nullptr;
+  for (auto &arg : args) body->addArgument(std::move(arg));
+  args.clear();
+  return std::move(body);
+}
+
+std::unique_ptr<Instruction> Expression::inlineCopy(Optimizer &optimizer) {
+  if (!optimizer.countNode()) return nullptr;
+  auto copy = std::make_unique<Expression>();
+  for (std::size_t i = 0; i < args.size(); ++i) {
+    auto argCopy = args[i]->inlineCopy(optimizer);
+    if (argCopy == nullptr) return nullptr;
+    copy->setArgument(std::move(argCopy));
+    if (i < types.size()) copy->setType(types[i]);
+  }
+  copy->numeric = numeric;
+  return std::move(copy);
+}
+
+std::unique_ptr<Instruction> CompareExpr::inlineCopy(Optimizer &optimizer) {
+  if (!optimizer.countNode()) return nullptr;
+  auto left = leftExpr->inlineCopy(optimizer);
+  if (left == nullptr) return nullptr;
+  if (rightExpr == nullptr)
+    return std::make_unique<CompareExpr>(std::move(left));
+  auto right = rightExpr->inlineCopy(optimizer);
+  if (right == nullptr) return nullptr;
+  return std::make_unique<CompareExpr>(type, std::move(left), std::move(right));
+}
+
+// Variable read before the assignment would be taken from the enclosing
+// scope, so only variables already assigned in the body can be updated
+std::unique_ptr<Instruction> AssignExpr::inlineCopy(Optimizer &optimizer) {
+  auto expressionCopy = expression->inlineCopy(optimizer);
+  if (expressionCopy == nullptr || !optimizer.countNode()) return nullptr;
+  auto renamed = type == Type::Assign ? optimizer.defineVariable(variableName)
+                                      : optimizer.renamedVariable(variableName);
+  if (renamed.empty()) return nullptr;
+  return std::make_unique<AssignExpr>(type, renamed, std::move(expressionCopy));
+}
+
+std::unique_ptr<InlinedCall> InlinedCall::copyBody(Optimizer &optimizer) {
+  optimizer.beginCopy("");
+  for (auto &parameter : parameters) optimizer.defineVariable(parameter);
+  auto copy = std::make_unique<InlinedCall>(name, parameters);
+  for (auto &statement : statements)
+    copy->addStatement(statement->inlineCopy(optimizer));
+  copy->setResult(result->inlineCopy(optimizer));
+  return copy;
+}
@@ -0,0 +1,133 @@
+// Copyright 2019 Kamil Mankowski
+
+#include "Instructions.h"
+
+#include <algorithm>
+
+#include "FrameLayout.h"
+
+// Declaration pass collects variables assigned in the scope, so reads can
+// be resolved to a local slot or to the enclosing scope declaring the name.
+// Bodies of nested functions are separate scopes.
+
+void CodeBlock::declare(FrameLayout &layout) {
+  for (auto &instr : instructions) instr->declare(layout);
+}
+
+void AssignExpr::declare(FrameLayout &layout) { layout.declare(variableName); }
+
+void If::declare(FrameLayout &layout) { ifCode->declare(layout); }
+
+void For::declare(FrameLayout &layout) {
+  layout.declare(iterator);
+  code->declare(layout);
+}
+
+void While::declare(FrameLayout &layout) { code->declare(layout); }
+
+// The name may be defined or not when called, calls look it up first
+void Function::declare(FrameLayout &layout) {
+  layout.declareFunction(name, nullptr);
+}
+
+// Only definitions in the body itself are bound to the scope, the ones in
+// conditional and loop blocks are defined when they are executed
+void CodeBlock::resolveScope(FrameLayout &layout) {
+  for (auto &instr : instructions) {
+    auto function = dynamic_cast<Function *>(instr.get());
+    if (function != nullptr)
+      layout.declareFunction(function->instrName(), function);
+    else
+      instr->declare(layout);
+  }
+  resolve(layout);
+}
+
+void CodeBlock::resolve(FrameLayout &layout) {
+  for (auto &instr : instructions) instr->resolve(layout);
+}
+
+void Function::resolve(FrameLayout &outer) {
+  layout = std::make_shared<FrameLayout>(&outer);
+  argumentSlots.clear();
+  for (auto &arg : argumentNames)
+    argumentSlots.push_back(layout->declare(arg));
+  if (code != nullptr) code->resolveScope(*layout);
+
+  // One pointer serves all calls of the function bound in the table, the
+  // definition is not executed again on each pass through the scope
+  auto found = outer.findFunction(name);
+  bound = found.function == this && !found.byName;
+  if (bound)
+    pointer = std::make_shared<FunctionPointer>(
+        name, argumentNames, code.get(), layout, argumentSlots);
+  outer.reachFunction(name);
+}
+
+void Variable::resolve(FrameLayout &layout) { ref = layout.find(name); }
+
+void Constant::resolve(FrameLayout &layout) {
+  for (auto &elem : listElements) elem->resolve(layout);
+}
+
+void Slice::resolve(FrameLayout &layout) { source->resolve(layout); }
+
+void FunctionCall::resolve(FrameLayout &layout) {
+  target = layout.findFunction(name, true);
+  for (auto &arg : args) arg->resolve(layout);
+}
+
+// Parameters and variables of the body become variables of the scope
+void InlinedCall::resolve(FrameLayout &layout) {
+  for (auto &arg : args) arg->resolve(layout);
+  slots.clear();
+  for (auto &parameter : parameters) slots.push_back(layout.declare(parameter));
+  for (auto &statement : statements) statement->resolve(layout);
+  result->resolve(layout);
+
+  renamed = parameters;
+  for (auto &statement : statements) {
+    auto assign = dynamic_cast<AssignExpr *>(statement.get());
+    if (assign == nullptr || assign->definedName().empty()) continue;
+    auto name = assign->definedName();
+    if (std::find(renamed.begin(), renamed.end(), name) == renamed.end())
+      renamed.push_back(name);
+  }
+  renamedSlots.clear();
+  for (auto &name : renamed) renamedSlots.push_back(layout.declare(name));
+}
+
+void Return::resolve(FrameLayout &layout) {
+  value->resolve(layout);
+  tailCall = dynamic_cast<FunctionCall *>(value.get());
+}
+
+void Expression::resolve(FrameLayout &layout) {
+  for (auto &arg : args) arg->resolve(layout);
+}
+
+void CompareExpr::resolve(FrameLayout &layout) {
+  leftExpr->resolve(layout);
+  if (rightExpr != nullptr) rightExpr->resolve(layout);
+}
+
+void AssignExpr::resolve(FrameLayout &layout) {
+  slot = layout.declare(variableName);
+  expression->resolve(layout);
+}
+
+void If::resolve(FrameLayout &layout) {
+  compare->resolve(layout);
+  ifCode->resolve(layout);
+}
+
+void For::resolve(FrameLayout &layout) {
+  iteratorSlot = layout.declare(iterator);
+  range->resolve(layout);
+  code->resolve(layout);
+}
+
+void While::resolve(FrameLayout &layout) {
+  compare->resolve(layout);
+  code->resolve(layout);
+}
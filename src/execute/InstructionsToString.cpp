@@ -35,6 +35,8 @@ std::string Constant::toString() {
     case ValueType::Text:
       return "\"" + strValue + "\"";
     case ValueType::List:
+      // Computed list has no element nodes
+      if (listElements.empty() && value != nullptr) return value->toString();
       return listToString();
     default:
       throw std::runtime_error("Constant type invalid.");
@@ -70,6 +72,16 @@ std::string FunctionCall::toString() {
   return out;
 }
 
+// Body is shown in braces, as there is no syntax for it
+std::string InlinedCall::toString() {
+  std::string out = "{";
+  for (int i = 0; i < args.size(); ++i)
+    out += parameters[i] + " = " + args[i]->toString() + "; ";
+  for (auto &statement : statements) out += statement->toString() + "; ";
+  out += "return " + result->toString() + "}";
+  return out;
+}
+
 std::string Expression::toString() {
   std::string out = "";
   for (int i = 0; i < args.size(); ++i) {
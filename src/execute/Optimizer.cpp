@@ -0,0 +1,121 @@
+// Copyright 2019 Kamil Mankowski
+
+#include "Optimizer.h"
+
+#include <utility>
+#include <vector>
+
+void Optimizer::optimize(CodeBlock &code) {
+  code.optimize(*this);
+  if (inlineSize == 0) return;
+
+  // Definitions are known after the first pass, calls are inlined in second
+  inlining = true;
+  code.optimize(*this);
+  inlining = false;
+}
+
+void Optimizer::optimize(std::unique_ptr<Instruction> &instr) {
+  instr->optimize(*this);
+  instr = Expression::flatten(std::move(instr));
+  if (!inlining) return;
+
+  auto call = dynamic_cast<FunctionCall *>(instr.get());
+  if (call == nullptr) return;
+  auto before = logging() ? call->toString() : "";
+  auto inlined = call->inlineCall(*this);
+  if (inlined == nullptr) return;
+  instr = std::move(inlined);
+  report(before, instr->toString());
+}
+
+std::shared_ptr<Value> Optimizer::foldOperation(std::shared_ptr<Value> left,
+                                                std::shared_ptr<Value> right,
+                                                Expression::Type op) {
+  // Integer division by zero is left to fail at runtime, if ever executed
+  if (op == Expression::Type::Div && right->getType() == ValueType::Int &&
+      right->getInt() == 0 && left->getType() == ValueType::Int)
+    return nullptr;
+  try {
+    return Expression::evaluate(left, right, op);
+  } catch (ExecuteExceptionBase &e) {
+    return nullptr;
+  }
+}
+
+std::shared_ptr<Value> Optimizer::foldCompare(std::shared_ptr<Value> left,
+                                              std::shared_ptr<Value> right,
+                                              CompareExpr::Type cmp) {
+  try {
+    return Value::makeBool(CompareExpr::evaluate(left, right, cmp));
+  } catch (ExecuteExceptionBase &e) {
+    return nullptr;
+  }
+}
+
+void Optimizer::defineFunction(Function &function) {
+  auto name = function.instrName();
+  if (!inlining) {
+    ++definitions[name];
+    return;
+  }
+  if (depth != 1 || definitions[name] != 1) return;
+  auto body = copyFunction(function);
+  if (body != nullptr) inlinable[name] = std::move(body);
+}
+
+std::unique_ptr<InlinedCall> Optimizer::copyFunction(Function &function) {
+  auto code = function.getCode();
+  if (code == nullptr || code->empty()) return nullptr;
+  auto &instructions = code->getInstructions();
+  auto returnInstr = dynamic_cast<Return *>(instructions.back().get());
+  if (returnInstr == nullptr) return nullptr;
+
+  beginCopy(function.instrName() + ".");
+  std::vector<std::string> parameters;
+  for (auto &arg : function.getArguments())
+    parameters.push_back(defineVariable(arg));
+  auto body = std::make_unique<InlinedCall>(function.instrName(), parameters);
+
+  for (std::size_t i = 0; i + 1 < instructions.size(); ++i) {
+    auto statement = instructions[i]->inlineCopy(*this);
+    if (statement == nullptr) return nullptr;
+    body->addStatement(std::move(statement));
+  }
+  auto result = returnInstr->getValue()->inlineCopy(*this);
+  if (result == nullptr) return nullptr;
+  body->setResult(std::move(result));
+  return body;
+}
+
+std::unique_ptr<InlinedCall> Optimizer::inlinedBody(
+    const std::string &name, std::size_t argumentsCount) {
+  auto found = inlinable.find(name);
+  if (found == inlinable.end()) return nullptr;
+  // Wrong number of arguments is reported at runtime by the call
+  if (found->second->parametersSize() != argumentsCount) return nullptr;
+  return found->second->copyBody(*this);
+}
+
+void Optimizer::beginCopy(const std::string &newPrefix) {
+  prefix = newPrefix;
+  renames.clear();
+  copiedNodes = 0;
+}
+
+std::string Optimizer::defineVariable(const std::string &name) {
+  auto found = renames.find(name);
+  if (found != renames.end()) return found->second;
+  return renames[name] = prefix + name;
+}
+
+std::string Optimizer::renamedVariable(const std::string &name) const {
+  auto found = renames.find(name);
+  return found != renames.end() ? found->second : "";
+}
+
+void Optimizer::report(const std::string &before, const std::string &after) {
+  ++rewritten;
+  if (log != nullptr)
+    *log << "optimized: " << before << " => " << after << "\n";
+}
@@ -0,0 +1,84 @@
+// Copyright 2019 Kamil Mankowski
+
+#ifndef SRC_EXECUTE_OPTIMIZER_H_
+#define SRC_EXECUTE_OPTIMIZER_H_
+
+#include <cstddef>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+
+#include "Instructions.h"
+
+// Rewrites the parsed tree before it is resolved and executed: folds
+// constant subexpressions and drops operations which do not change the
+// value. When the log is given, every rewritten node is reported there.
+//
+// With the inline size above zero, calls of small functions are replaced by
+// their bodies in the second pass. Only functions defined once, at the top
+// level of the program, are inlined, at calls placed after the definition.
+// The body must be a sequence of assignments and calls of not user defined
+// functions ending with return, which uses only own variables and at most
+// `inlineSize` nodes.
+class Optimizer {
+ public:
+  static constexpr std::size_t defaultInlineSize = 16;
+
+  explicit Optimizer(std::ostream *log = nullptr, std::size_t inlineSize = 0)
+      : log(log), inlineSize(inlineSize) {}
+
+  void optimize(CodeBlock &code);
+  // Optimizes the node and replaces it by the simpler one, if possible
+  void optimize(std::unique_ptr<Instruction> &instr);
+
+  // Result of the operation on constant operands, nullptr when it cannot be
+  // computed before execution (e.g. it would throw)
+  static std::shared_ptr<Value> foldOperation(std::shared_ptr<Value> left,
+                                              std::shared_ptr<Value> right,
+                                              Expression::Type op);
+  static std::shared_ptr<Value> foldCompare(std::shared_ptr<Value> left,
+                                            std::shared_ptr<Value> right,
+                                            CompareExpr::Type cmp);
+
+  void enterBlock() { ++depth; }
+  void leaveBlock() { --depth; }
+  // Called after the body of the function was optimized
+  void defineFunction(Function &function);
+  bool isUserFunction(const std::string &name) const {
+    return definitions.count(name) != 0;
+  }
+  // Copy of the body to inline in place of the call, nullptr if none
+  std::unique_ptr<InlinedCall> inlinedBody(const std::string &name,
+                                           std::size_t argumentsCount);
+
+  // Variables of the copied body are renamed by adding the prefix
+  void beginCopy(const std::string &prefix);
+  std::string defineVariable(const std::string &name);
+  // Name of the variable in the copy, empty when it is not defined yet
+  std::string renamedVariable(const std::string &name) const;
+  // Counts copied node, false when the body is too big to be inlined
+  bool countNode() { return ++copiedNodes <= inlineSize; }
+
+  bool logging() const { return log != nullptr; }
+  void report(const std::string &before, const std::string &after);
+  std::size_t rewrittenCount() const { return rewritten; }
+
+ private:
+  std::ostream *log;
+  std::size_t rewritten = 0;
+
+  std::size_t inlineSize;
+  bool inlining = false;
+  int depth = 0;
+  std::map<std::string, int> definitions;
+  std::map<std::string, std::unique_ptr<InlinedCall>> inlinable;
+
+  std::string prefix;
+  std::map<std::string, std::string> renames;
+  std::size_t copiedNodes = 0;
+
+  std::unique_ptr<InlinedCall> copyFunction(Function &function);
+};
+
+#endif  // SRC_EXECUTE_OPTIMIZER_H_
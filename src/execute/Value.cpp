@@ -2,6 +2,207 @@
 
 #include "Value.h"
 
+namespace {
+const std::string emptyStr;
+const std::vector<std::shared_ptr<Value>> emptyList;
+
+const std::int64_t smallIntMin = -256;
+const std::int64_t smallIntMax = 65535;
+}  // namespace
+
+// Reference count is not atomic, values are used by one thread
+struct Value::ListPayload {
+  explicit ListPayload(std::vector<std::shared_ptr<Value>> elements)
+      : elements(std::move(elements)) {}
+  explicit ListPayload(const Range &range)
+      : isRange(true), materialized(false), range(range) {}
+
+  std::size_t refs = 1;
+  std::vector<std::shared_ptr<Value>> elements;
+  // Range describes the elements, which are created on first getList()
+  bool isRange = false;
+  bool materialized = true;
+  Range range = {0, 1, 0};
+};
+
+Value::Range Value::Range::fromBounds(std::int64_t start, std::int64_t end,
+                                      std::int64_t step) {
+  std::size_t length = 0;
+  if (step > 0 && end > start) length = (end - start + step - 1) / step;
+  if (step < 0 && end < start) length = (start - end - step - 1) / -step;
+  return Range{start, step, length};
+}
+
+// Singletons are leaked, so they outlive values destroyed at exit
+std::shared_ptr<Value> Value::makeNone() {
+  static auto none = new std::shared_ptr<Value>(std::make_shared<Value>());
+  return *none;
+}
+
+std::shared_ptr<Value> Value::makeBool(bool value) {
+  static auto trueValue =
+      new std::shared_ptr<Value>(std::make_shared<Value>(true));
+  static auto falseValue =
+      new std::shared_ptr<Value>(std::make_shared<Value>(false));
+  return value ? *trueValue : *falseValue;
+}
+
+// Cached integers are created on first use
+std::shared_ptr<Value> Value::makeInt(std::int64_t value) {
+  if (value < smallIntMin || value > smallIntMax)
+    return std::make_shared<Value>(value);
+  static auto cache = new std::vector<std::shared_ptr<Value>>(
+      smallIntMax - smallIntMin + 1);
+  auto &cached = (*cache)[value - smallIntMin];
+  if (cached == nullptr) cached = std::make_shared<Value>(value);
+  return cached;
+}
+
+Value::Value(std::vector<std::shared_ptr<Value>> &elements)
+    : type(ValueType::List), list(new ListPayload(elements)) {}
+
+Value::Value(std::vector<std::shared_ptr<Value>> &&elements)
+    : type(ValueType::List), list(new ListPayload(std::move(elements))) {}
+
+Value::Value(const Range &range)
+    : type(ValueType::List), list(new ListPayload(range)) {}
+
+Value::Value(const Value &other) : type(other.type), intValue(other.intValue) {
+  copyPayload(other);
+}
+
+Value::Value(Value &&other) noexcept
+    : type(other.type), intValue(other.intValue) {
+  other.type = ValueType::None;
+  other.intValue = 0;
+}
+
+Value &Value::operator=(const Value &other) {
+  if (this == &other) return *this;
+  release();
+  type = other.type;
+  intValue = other.intValue;
+  copyPayload(other);
+  return *this;
+}
+
+Value &Value::operator=(Value &&other) noexcept {
+  if (this == &other) return *this;
+  release();
+  type = other.type;
+  intValue = other.intValue;
+  other.type = ValueType::None;
+  other.intValue = 0;
+  return *this;
+}
+
+bool Value::hasPayload() const {
+  return (type == ValueType::Text || type == ValueType::List) &&
+         strValue != nullptr;
+}
+
+void Value::release() {
+  if (!hasPayload()) return;
+  if (type == ValueType::Text)
+    delete strValue;
+  else if (type == ValueType::List && --list->refs == 0)
+    delete list;
+  intValue = 0;
+}
+
+void Value::copyPayload(const Value &other) {
+  if (!other.hasPayload()) return;
+  if (type == ValueType::Text)
+    strValue = new std::string(*other.strValue);
+  else
+    ++list->refs;
+}
+
+void Value::setType(ValueType newType) {
+  if (newType == type) return;
+  release();
+  type = newType;
+  intValue = 0;
+}
+
+void Value::setInt(std::int64_t val) {
+  release();
+  type = ValueType::Int;
+  intValue = val;
+}
+
+void Value::setReal(double val) {
+  release();
+  type = ValueType::Real;
+  realValue = val;
+}
+
+void Value::setBool(bool val) {
+  release();
+  type = ValueType::Bool;
+  intValue = 0;
+  boolValue = val;
+}
+
+const std::string &Value::getStr() {
+  if (type != ValueType::Text || strValue == nullptr) return emptyStr;
+  return *strValue;
+}
+
+void Value::setStr(std::string str) {
+  if (type == ValueType::Text && strValue != nullptr) {
+    *strValue = std::move(str);
+    return;
+  }
+  release();
+  type = ValueType::Text;
+  strValue = new std::string(std::move(str));
+}
+
+const std::vector<std::shared_ptr<Value>> &Value::getList() {
+  if (type != ValueType::List || list == nullptr) return emptyList;
+  if (!list->materialized) {
+    auto &range = list->range;
+    list->elements.reserve(range.length);
+    for (std::size_t i = 0; i < range.length; ++i)
+      list->elements.push_back(makeInt(range.at(i)));
+    list->materialized = true;
+  }
+  return list->elements;
+}
+
+std::vector<std::shared_ptr<Value>> &Value::getMutableList() {
+  if (type != ValueType::List) setType(ValueType::List);
+  if (list == nullptr) {
+    list = new ListPayload(std::vector<std::shared_ptr<Value>>{});
+  } else if (list->refs > 1) {
+    auto shared = list;
+    list = new ListPayload(getList());
+    --shared->refs;
+  }
+  getList();
+  list->isRange = false;
+  return list->elements;
+}
+
+std::shared_ptr<Value> Value::getElement(std::size_t index) {
+  if (list->materialized) return list->elements[index];
+  return makeInt(list->range.at(index));
+}
+
+bool Value::isRange() {
+  return type == ValueType::List && list != nullptr && list->isRange;
+}
+
+const Value::Range &Value::getRange() { return list->range; }
+
+std::size_t Value::size() {
+  if (type == ValueType::Text) return getStr().size();
+  if (type != ValueType::List || list == nullptr) return 0;
+  if (!list->materialized) return list->range.length;
+  return list->elements.size();
+}
+
 std::string Value::toString() {
   switch (type) {
     case ValueType::None:
@@ -13,19 +214,19 @@ std::string Value::toString() {
     case ValueType::Real:
       return std::to_string(realValue);
     case ValueType::Text:
-      return "\"" + strValue + "\"";
+      return "\"" + getStr() + "\"";
     case ValueType::List:
       return listToString();
-    default:
-      return "CONTROL VARIABLE";
   }
+  return "";
 }
 
 std::string Value::listToString() {
   std::string out = "[";
-  for (int i = 0; i < listElements.size(); ++i) {
-    out += listElements[i]->toString();
-    if (i != listElements.size() - 1) out += ", ";
+  auto count = size();
+  for (std::size_t i = 0; i < count; ++i) {
+    out += getElement(i)->toString();
+    if (i != count - 1) out += ", ";
   }
   out += "]";
   return out;
@@ -3,62 +3,112 @@
 #ifndef SRC_EXECUTE_VALUE_H_
 #define SRC_EXECUTE_VALUE_H_
 
+#include <cstddef>
+#include <cstdint>
 #include <iostream>
 #include <memory>
 #include <string>
 #include <utility>
 #include <vector>
 
-enum class ValueType {
+enum class ValueType : std::uint8_t {
   None,
   Bool,
   Int,
   Real,
   Text,
-  List,
-  T_CONTINUE,
-  T_BREAK,
-  T_RETURN
+  List
 };
 
+// Tagged union: numbers, booleans and None are stored inline, strings and
+// lists live out of line and are owned by the Value.
+// List elements are shared between copies and duplicated only when one of
+// them asks for mutable access (copy-on-write). List made by range() keeps
+// only the bounds and creates elements when whole list is needed.
+// Setters change type of the value to the type of the stored data.
+// Values given by makeNone(), makeBool() and makeInt() can be shared by the
+// whole program and must not be changed.
 class Value {
  public:
-  Value() : type(ValueType::None) {}
-  Value(ValueType type, std::shared_ptr<Value> val)
-      : type(type), val_ptr(val) {}
-  explicit Value(ValueType type) : type(type) {}
-  explicit Value(bool value) : type(ValueType::Bool), boolValue(value) {}
+  // Elements start, start + step, ... of the lazy list
+  struct Range {
+    std::int64_t start;
+    std::int64_t step;
+    std::size_t length;
+
+    std::int64_t at(std::size_t index) const {
+      return start + static_cast<std::int64_t>(index) * step;
+    }
+    static Range fromBounds(std::int64_t start, std::int64_t end,
+                            std::int64_t step);
+  };
+
+  Value() : type(ValueType::None), intValue(0) {}
+  explicit Value(ValueType type) : type(type), intValue(0) {}
+  explicit Value(bool value) : type(ValueType::Bool), intValue(0) {
+    boolValue = value;
+  }
   explicit Value(std::int64_t value) : type(ValueType::Int), intValue(value) {}
   explicit Value(double value) : type(ValueType::Real), realValue(value) {}
-  explicit Value(std::string value) : type(ValueType::Text), strValue(value) {}
-  explicit Value(std::vector<std::shared_ptr<Value>> &elements)
-      : type(ValueType::List), listElements(elements) {}
+  explicit Value(std::string value)
+      : type(ValueType::Text), strValue(new std::string(std::move(value))) {}
+  explicit Value(std::vector<std::shared_ptr<Value>> &elements);
+  explicit Value(std::vector<std::shared_ptr<Value>> &&elements);
+  explicit Value(const Range &range);
+
+  // Preallocated None, True, False and small integers, never released
+  static std::shared_ptr<Value> makeNone();
+  static std::shared_ptr<Value> makeBool(bool value);
+  static std::shared_ptr<Value> makeInt(std::int64_t value);
+
+  Value(const Value &other);
+  Value(Value &&other) noexcept;
+  Value &operator=(const Value &other);
+  Value &operator=(Value &&other) noexcept;
+  ~Value() { release(); }
 
   ValueType getType() { return type; }
-  void setType(ValueType newType) { type = newType; }
+  void setType(ValueType newType);
   std::int64_t getInt() { return intValue; }
-  void setInt(std::int64_t val) { intValue = val; }
+  void setInt(std::int64_t val);
   double getReal() { return realValue; }
-  void setReal(double val) { realValue = val; }
-  std::string getStr() { return strValue; }
-  void setStr(std::string str) { strValue = str; }
-  std::vector<std::shared_ptr<Value>> getList() { return listElements; }
-  void setBool(bool val) { boolValue = val; }
+  void setReal(double val);
+  // Strings and lists are accessed in place, reference is valid as long as
+  // the value is alive and not changed. Wrong type gives empty payload.
+  const std::string &getStr();
+  void setStr(std::string str);
+  const std::vector<std::shared_ptr<Value>> &getList();
+  // Detaches elements shared with other values, changes type to list
+  std::vector<std::shared_ptr<Value>> &getMutableList();
+  // Count of list elements or string characters
+  std::size_t size();
+  // List element, without creating the whole list for the range
+  std::shared_ptr<Value> getElement(std::size_t index);
+  bool isRange();
+  const Range &getRange();
+  void setBool(bool val);
   bool getBool() { return boolValue; }
-  std::shared_ptr<Value> getValuePtr() { return val_ptr; }
 
   std::string toString();
 
  private:
   ValueType type;
-  std::int64_t intValue;
-  double realValue;
-  bool boolValue;
-  std::string strValue;
-  std::vector<std::shared_ptr<Value>> listElements;
-  std::shared_ptr<Value> val_ptr;
+  struct ListPayload;
+  union {
+    std::int64_t intValue;
+    double realValue;
+    bool boolValue;
+    std::string *strValue;
+    ListPayload *list;
+  };
+
+  bool hasPayload() const;
+  void release();
+  void copyPayload(const Value &other);
 
   std::string listToString();
 };
 
+static_assert(sizeof(Value) == 16, "Value should fit in two words");
+
 #endif  // SRC_EXECUTE_VALUE_H_
@@ -36,6 +36,41 @@ BOOST_AUTO_TEST_CASE(test_range) {
   BOOST_TEST(list[2]->getInt() == 2);
 }
 
+std::shared_ptr<Value> exec_range(std::vector<int64_t> args) {
+  auto ctx = std::make_shared<Context>();
+  for (auto arg : args) ctx->addParameter(std::make_shared<Value>(arg));
+  RangeFunction range;
+  return range.exec(ctx);
+}
+
+BOOST_AUTO_TEST_CASE(test_range_is_lazy) {
+  auto result = exec_range({1000000000000L});
+
+  BOOST_TEST(result->isRange());
+  BOOST_TEST(result->size() == 1000000000000UL);
+  BOOST_TEST(result->getElement(999999999999UL)->getInt() == 999999999999L);
+}
+
+BOOST_AUTO_TEST_CASE(test_range_start_step) {
+  auto result = exec_range({2, 9, 3});
+  BOOST_TEST(result->size() == 3);
+  BOOST_TEST(result->getList()[2]->getInt() == 8);
+
+  result = exec_range({5, 0, -2});
+  BOOST_TEST(result->size() == 3);
+  BOOST_TEST(result->getElement(2)->getInt() == 1);
+
+  BOOST_TEST(exec_range({3, 1})->size() == 0);
+}
+
+BOOST_AUTO_TEST_CASE(test_range_zero_step) {
+  BOOST_CHECK_THROW(exec_range({1, 5, 0}), RangeStepZero);
+}
+
+BOOST_AUTO_TEST_CASE(test_range_too_many_args) {
+  BOOST_CHECK_THROW(exec_range({1, 5, 1, 1}), ParametersCountNotExpected);
+}
+
 BOOST_AUTO_TEST_CASE(test_range_no_arg) {
   auto ctx = std::make_shared<Context>();
 
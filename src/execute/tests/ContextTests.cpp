@@ -154,6 +154,152 @@ BOOST_AUTO_TEST_CASE(test_cover_inherited_variable) {
   BOOST_TEST(parent->getVariableValue(name) == val1);
 }
 
+BOOST_AUTO_TEST_CASE(test_layout_declare_once) {
+  FrameLayout layout;
+
+  BOOST_TEST(layout.declare("a") == 0);
+  BOOST_TEST(layout.declare("b") == 1);
+  BOOST_TEST(layout.declare("a") == 0);
+  BOOST_TEST(layout.size() == 2);
+  BOOST_TEST(layout.slotOf("b") == 1);
+  BOOST_TEST(layout.slotOf("c") == -1);
+}
+
+BOOST_AUTO_TEST_CASE(test_layout_find_in_enclosing) {
+  FrameLayout global;
+  global.declare("g");
+  FrameLayout outer(&global);
+  outer.declare("a");
+  FrameLayout inner(&outer);
+  inner.declare("b");
+
+  auto local = inner.find("b");
+  BOOST_TEST(local.depth == 0);
+  BOOST_TEST(local.slot == 0);
+  auto enclosing = inner.find("a");
+  BOOST_TEST(enclosing.depth == 1);
+  BOOST_TEST(enclosing.slot == 0);
+  BOOST_TEST(inner.find("g").depth == VariableRef::Global);
+  BOOST_TEST(global.find("g").depth == 0);
+  BOOST_TEST(inner.find("none").slot == -1);
+}
+
+BOOST_AUTO_TEST_CASE(test_layout_find_function) {
+  Function first("f"), second("f"), other("g");
+  FrameLayout global;
+  global.declareFunction("g", &other);
+  FrameLayout outer(&global);
+  outer.declareFunction("f", &first);
+  FrameLayout inner(&outer);
+
+  auto enclosing = inner.findFunction("f");
+  BOOST_TEST(enclosing.depth == 1);
+  BOOST_TEST(enclosing.function == &first);
+  BOOST_TEST(inner.findFunction("g").depth == VariableRef::Global);
+  BOOST_TEST(inner.findFunction("g").function == &other);
+  BOOST_TEST(inner.findFunction("none").function == nullptr);
+
+  outer.declareFunction("f", &first);
+  BOOST_TEST(inner.findFunction("f").function == &first);
+  outer.declareFunction("f", &second);
+  BOOST_TEST(inner.findFunction("f").function == nullptr);
+}
+
+BOOST_AUTO_TEST_CASE(test_global_slot_variable) {
+  auto layout = std::make_shared<FrameLayout>();
+  int slot = layout->declare("myval");
+  auto val = std::make_shared<Value>(18L);
+  auto global = std::make_shared<Context>();
+  global->setLayout(layout);
+  global->setVariable(slot, "myval", val);
+
+  auto child = std::make_shared<Context>(global);
+  Context cxt(child);
+
+  auto ref = VariableRef{VariableRef::Global, slot};
+  BOOST_TEST(cxt.getVariableValue(ref, "myval") == val);
+  BOOST_TEST(cxt.getVariableValue(VariableRef{2, slot}, "myval") == val);
+}
+
+BOOST_AUTO_TEST_CASE(test_slot_variable) {
+  auto layout = std::make_shared<FrameLayout>();
+  int slot = layout->declare("myval");
+  auto val = std::make_shared<Value>(18L);
+
+  Context cxt;
+  cxt.setLayout(layout);
+  cxt.setVariable(slot, "myval", val);
+
+  BOOST_TEST(cxt.getVariableValue(slot, "myval") == val);
+  BOOST_TEST(cxt.getVariableValue("myval") == val);
+}
+
+BOOST_AUTO_TEST_CASE(test_named_variable_stored_in_slot) {
+  auto layout = std::make_shared<FrameLayout>();
+  int slot = layout->declare("myval");
+  auto val = std::make_shared<Value>(18L);
+
+  Context cxt;
+  cxt.setLayout(layout);
+  cxt.setVariable("myval", val);
+
+  BOOST_TEST(cxt.getVariableValue(slot, "myval") == val);
+}
+
+BOOST_AUTO_TEST_CASE(test_empty_slot_inherited_variable) {
+  auto parent = std::make_shared<Context>();
+  auto val = std::make_shared<Value>(18L);
+  parent->setVariable("myval", val);
+
+  auto layout = std::make_shared<FrameLayout>();
+  int slot = layout->declare("myval");
+  Context cxt(parent);
+  cxt.setLayout(layout);
+
+  BOOST_TEST(cxt.getVariableValue(slot, "myval") == val);
+  BOOST_TEST(cxt.getVariableValue("myval") == val);
+}
+
+BOOST_AUTO_TEST_CASE(test_counter_changed_in_place) {
+  auto layout = std::make_shared<FrameLayout>();
+  int slot = layout->declare("i");
+  Context cxt;
+  cxt.setLayout(layout);
+  std::shared_ptr<Value> counter;
+
+  cxt.setCounter(slot, "i", counter, 1);
+  auto first = counter.get();
+  cxt.setCounter(slot, "i", counter, 2);
+
+  BOOST_TEST(counter.get() == first);
+  BOOST_TEST(cxt.getVariableValue(slot, "i")->getInt() == 2);
+}
+
+BOOST_AUTO_TEST_CASE(test_shared_counter_not_changed) {
+  auto layout = std::make_shared<FrameLayout>();
+  int slot = layout->declare("i");
+  Context cxt;
+  cxt.setLayout(layout);
+  std::shared_ptr<Value> counter;
+
+  cxt.setCounter(slot, "i", counter, 1);
+  auto kept = cxt.getVariableValue(slot, "i");
+  cxt.setCounter(slot, "i", counter, 2);
+
+  BOOST_TEST(kept->getInt() == 1);
+  BOOST_TEST(cxt.getVariableValue(slot, "i")->getInt() == 2);
+}
+
+BOOST_AUTO_TEST_CASE(test_slot_without_layout_uses_name) {
+  auto val = std::make_shared<Value>(18L);
+
+  Context cxt;
+  cxt.setVariable(3, "myval", val);
+
+  BOOST_TEST(cxt.getVariableValue("myval") == val);
+  BOOST_TEST(cxt.getVariableValue(3, "myval") == val);
+}
+
 BOOST_AUTO_TEST_CASE(test_cover_inherited_function) {
   auto parent = std::make_shared<Context>();
 
@@ -170,4 +316,14 @@ BOOST_AUTO_TEST_CASE(test_cover_inherited_function) {
   BOOST_TEST(parent->getFunction(name) == func1);
 }
 
+BOOST_AUTO_TEST_CASE(test_return_value_taken_once) {
+  Context cxt;
+  auto val = std::make_shared<Value>(4L);
+
+  cxt.setReturnValue(val);
+
+  BOOST_TEST(cxt.takeReturnValue() == val);
+  BOOST_TEST(cxt.takeReturnValue() == nullptr);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
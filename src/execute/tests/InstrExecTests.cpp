@@ -2,6 +2,8 @@
 
 #include <boost/test/unit_test.hpp>
 
+#include "../../bytecode/Compiler.h"
+#include "../../bytecode/VirtualMachine.h"
 #include "../Context.h"
 #include "../ExecuteExceptions.h"
 #include "../Instructions.h"
@@ -137,6 +139,34 @@ BOOST_AUTO_TEST_CASE(test_list_constant_exec_values) {
   BOOST_TEST(list_vals[2]->getBool() == false);
 }
 
+BOOST_AUTO_TEST_CASE(test_constant_list_built_once) {
+  std::vector<std::unique_ptr<Instruction>> elements;
+  elements.push_back(constant<int64_t>(1L));
+  elements.push_back(constant_expr(constant<std::string>("element2")));
+
+  Constant list(std::move(elements));
+  auto val = list.exec(empty_context());
+
+  BOOST_TEST(list.exec(empty_context()) == val);
+  BOOST_TEST(list.constantValue() == val);
+  BOOST_TEST(val->getList()[1]->getStr() == "element2");
+}
+
+BOOST_AUTO_TEST_CASE(test_list_with_variable_built_each_time) {
+  auto ctx = empty_context();
+  ctx->setVariable("var", get_value<int64_t>(4L));
+  std::vector<std::unique_ptr<Instruction>> elements;
+  elements.push_back(constant<int64_t>(1L));
+  elements.push_back(std::make_unique<Variable>("var"));
+
+  Constant list(std::move(elements));
+  auto val = list.exec(ctx);
+
+  BOOST_TEST(list.constantValue() == nullptr);
+  BOOST_TEST(list.exec(ctx) != val);
+  BOOST_TEST(val->getList()[1]->getInt() == 4L);
+}
+
 BOOST_AUTO_TEST_CASE(test_variable_get_from_ctx) {
   auto ctx = empty_context();
   std::string name = "var";
@@ -166,10 +196,10 @@ BOOST_AUTO_TEST_CASE(test_return_exec) {
   Return ret;
   ret.setValue(std::move(instr));
 
-  auto result = ret.exec(ctx);
+  auto flow = ret.execStatement(ctx);
 
-  BOOST_TEST((result->getType() == ValueType::T_RETURN));
-  BOOST_TEST((result->getValuePtr()->getType() == ValueType::None));
+  BOOST_TEST((flow == Flow::Return));
+  BOOST_TEST((ctx->takeReturnValue()->getType() == ValueType::None));
   BOOST_TEST(MockInstruction::getExecutedCount() == 1);
 }
 
@@ -177,18 +207,18 @@ BOOST_AUTO_TEST_CASE(test_break_exec) {
   auto ctx = empty_context();
 
   Break br;
-  auto result = br.exec(ctx);
+  auto flow = br.execStatement(ctx);
 
-  BOOST_TEST((result->getType() == ValueType::T_BREAK));
+  BOOST_TEST((flow == Flow::Break));
 }
 
 BOOST_AUTO_TEST_CASE(test_continue_exec) {
   auto ctx = empty_context();
 
   Continue cn;
-  auto result = cn.exec(ctx);
+  auto flow = cn.execStatement(ctx);
 
-  BOOST_TEST((result->getType() == ValueType::T_CONTINUE));
+  BOOST_TEST((flow == Flow::Continue));
 }
 
 BOOST_AUTO_TEST_CASE(test_code_block_simple) {
@@ -199,9 +229,9 @@ BOOST_AUTO_TEST_CASE(test_code_block_simple) {
   cb.addInstruction(mock_instr());
 
   MockInstruction::resetExecutedCount();
-  auto result = cb.exec(ctx);
+  auto flow = cb.execStatement(ctx);
 
-  BOOST_TEST((result->getType() == ValueType::None));
+  BOOST_TEST((flow == Flow::Normal));
   BOOST_TEST(MockInstruction::getExecutedCount() == 3);
 }
 
@@ -213,9 +243,9 @@ BOOST_AUTO_TEST_CASE(test_code_block_break) {
   cb.addInstruction(mock_instr());
 
   MockInstruction::resetExecutedCount();
-  auto result = cb.exec(ctx);
+  auto flow = cb.execStatement(ctx);
 
-  BOOST_TEST((result->getType() == ValueType::T_BREAK));
+  BOOST_TEST((flow == Flow::Break));
   BOOST_TEST(MockInstruction::getExecutedCount() == 1);
 }
 
@@ -227,9 +257,9 @@ BOOST_AUTO_TEST_CASE(test_code_block_continue) {
   cb.addInstruction(mock_instr());
 
   MockInstruction::resetExecutedCount();
-  auto result = cb.exec(ctx);
+  auto flow = cb.execStatement(ctx);
 
-  BOOST_TEST((result->getType() == ValueType::T_CONTINUE));
+  BOOST_TEST((flow == Flow::Continue));
   BOOST_TEST(MockInstruction::getExecutedCount() == 1);
 }
 
@@ -243,9 +273,9 @@ BOOST_AUTO_TEST_CASE(test_code_block_return) {
   cb.addInstruction(mock_instr());
 
   MockInstruction::resetExecutedCount();
-  auto result = cb.exec(ctx);
+  auto flow = cb.execStatement(ctx);
 
-  BOOST_TEST((result->getType() == ValueType::T_RETURN));
+  BOOST_TEST((flow == Flow::Return));
   BOOST_TEST(MockInstruction::getExecutedCount() == 1);
 }
 
@@ -367,6 +397,34 @@ BOOST_AUTO_TEST_CASE(test_function_call_not_declared) {
   BOOST_CHECK_THROW(call.exec(ctx), FunctionNotDeclared);
 }
 
+// f()
+// def f():
+//   return 1
+BOOST_AUTO_TEST_CASE(test_function_call_before_definition) {
+  auto body = std::make_unique<CodeBlock>();
+  auto ret = std::make_unique<Return>();
+  ret->setValue(constant<int64_t>(1L));
+  body->addInstruction(std::move(ret));
+  auto func = std::make_unique<Function>("f");
+  func->setCode(std::move(body));
+  CodeBlock code;
+  code.addInstruction(std::make_unique<FunctionCall>("f"));
+  code.addInstruction(std::move(func));
+
+  auto layout = std::make_shared<FrameLayout>();
+  code.resolveScope(*layout);
+  auto ctx = empty_context();
+  ctx->setLayout(layout);
+  BOOST_CHECK_THROW(code.execStatement(ctx), FunctionNotDeclared);
+
+  bytecode::Compiler compiler;
+  auto module = compiler.compile(code);
+  bytecode::VirtualMachine vm(*module);
+  ctx = empty_context();
+  ctx->setLayout(layout);
+  BOOST_CHECK_THROW(vm.run(ctx), FunctionNotDeclared);
+}
+
 BOOST_AUTO_TEST_CASE(test_expr_list_bad_operands_throw) {
   auto lef_operand_creator = get_list_of_ints;
 
@@ -475,6 +533,24 @@ BOOST_AUTO_TEST_CASE(test_list_mul) {
   BOOST_TEST(newlist[5]->getInt() == 3);
 }
 
+BOOST_AUTO_TEST_CASE(test_int_mul_operands_order) {
+  auto ctx = empty_context();
+  Expression expr;
+  expr.setArgument(constant<int64_t>(2));
+  expr.setType(Expression::Type::Mul);
+  expr.setArgument(get_list_of_ints());
+  auto result = expr.exec(ctx);
+
+  BOOST_TEST((result->getType() == ValueType::List));
+  BOOST_TEST(result->getList().size() == 6);
+  BOOST_TEST(result->getList()[3]->getInt() == 1);
+
+  std::vector<std::unique_ptr<Constant>> bad_operands;
+  bad_operands.push_back(constant<std::string>("test"));
+  test_expr_bad_operands([] { return constant<int64_t>(2); },
+                         std::move(bad_operands), Expression::Type::Mul);
+}
+
 BOOST_AUTO_TEST_CASE(test_list_mul_negative) {
   auto ctx = empty_context();
   auto list = get_list_of_ints();
@@ -533,6 +609,25 @@ BOOST_AUTO_TEST_CASE(test_list_add) {
 
   BOOST_TEST((result->getType() == ValueType::List));
   BOOST_TEST(result->getList().size() == 6);
+  BOOST_TEST(result->getList()[3]->getInt() == 1);
+}
+
+BOOST_AUTO_TEST_CASE(test_list_add_assign) {
+  auto ctx = empty_context();
+  std::vector<std::shared_ptr<Value>> elements{std::make_shared<Value>(1L)};
+  ctx->setVariable("a", std::make_shared<Value>(std::move(elements)));
+  auto list = ctx->getVariableValue("a").get();
+
+  AssignExpr append(AssignExpr::Type::AddAssign, "a", get_list_of_ints());
+  append.exec(ctx);
+  // List not seen by any other name is extended in place
+  BOOST_TEST(ctx->getVariableValue("a").get() == list);
+  BOOST_TEST(list->size() == 4);
+
+  auto alias = ctx->getVariableValue("a");
+  append.exec(ctx);
+  BOOST_TEST(alias->size() == 4);
+  BOOST_TEST(ctx->getVariableValue("a")->size() == 7);
 }
 
 BOOST_AUTO_TEST_CASE(test_str_add) {
@@ -644,6 +739,27 @@ BOOST_AUTO_TEST_CASE(test_expression_multiple_op_throw) {
   BOOST_CHECK_THROW(expr.exec(ctx), OperandsTypesNotCompatible);
 }
 
+BOOST_AUTO_TEST_CASE(test_expression_flatten) {
+  auto variable = std::make_unique<Variable>("var");
+  auto variablePtr = variable.get();
+  auto expr = std::make_unique<Expression>();
+  expr->setArgument(std::move(variable));
+
+  auto flattened = Expression::flatten(std::move(expr));
+  BOOST_TEST(flattened.get() == variablePtr);
+}
+
+BOOST_AUTO_TEST_CASE(test_expression_flatten_keeps_operations) {
+  auto expr = std::make_unique<Expression>();
+  expr->setArgument(constant<int64_t>(2));
+  expr->setType(Expression::Type::Mul);
+  expr->setArgument(constant<int64_t>(4));
+  auto exprPtr = expr.get();
+
+  auto flattened = Expression::flatten(std::move(expr));
+  BOOST_TEST(flattened.get() == exprPtr);
+}
+
 BOOST_AUTO_TEST_CASE(test_new_assign_expr) {
   auto ctx = empty_context();
   std::string name = "var";
@@ -687,6 +803,39 @@ BOOST_AUTO_TEST_CASE(test_override_assign_expr) {
   BOOST_TEST(ctx->getVariableValue(name)->getInt() == 5);
 }
 
+BOOST_AUTO_TEST_CASE(test_resolved_assign_expr) {
+  auto layout = std::make_shared<FrameLayout>();
+  auto ctx = empty_context();
+  std::string name = "var";
+
+  AssignExpr expr(AssignExpr::Type::Assign, name, expression_const_5());
+  expr.resolve(*layout);
+  ctx->setLayout(layout);
+  expr.exec(ctx);
+
+  BOOST_TEST(layout->slotOf(name) == 0);
+  BOOST_TEST(ctx->getVariableValue(0, name)->getInt() == 5);
+  BOOST_TEST(ctx->getVariableValue(name)->getInt() == 5);
+}
+
+BOOST_AUTO_TEST_CASE(test_add_assign_expr_types_change) {
+  auto ctx = empty_context();
+  std::string name = "var";
+  AssignExpr expr(AssignExpr::Type::AddAssign, name, expression_const_5());
+
+  ctx->setVariable(name, std::make_shared<Value>(3L));
+  expr.exec(ctx);
+  expr.exec(ctx);
+  BOOST_TEST(ctx->getVariableValue(name)->getInt() == 13);
+
+  ctx->setVariable(name, std::make_shared<Value>(0.5));
+  expr.exec(ctx);
+  BOOST_TEST(ctx->getVariableValue(name)->getReal() == 5.5);
+
+  ctx->setVariable(name, std::make_shared<Value>(std::string("text")));
+  BOOST_CHECK_THROW(expr.exec(ctx), OperandsTypesNotCompatible);
+}
+
 BOOST_AUTO_TEST_CASE(test_sub_assign_expr_no_var_throw) {
   auto ctx = empty_context();
   std::string name = "var";
@@ -912,6 +1061,51 @@ BOOST_AUTO_TEST_CASE(test_compare_nocomp) {
   BOOST_TEST(result->getInt() == value);
 }
 
+BOOST_AUTO_TEST_CASE(test_expression_types_change) {
+  auto ctx = empty_context();
+  Expression expr;
+  expr.setArgument(std::make_unique<Variable>("left"));
+  expr.setType(Expression::Type::Add);
+  expr.setArgument(std::make_unique<Variable>("right"));
+
+  ctx->setVariable("left", get_value<int64_t>(2L));
+  ctx->setVariable("right", get_value<int64_t>(3L));
+  BOOST_TEST(expr.exec(ctx)->getInt() == 5);
+  BOOST_TEST(expr.exec(ctx)->getInt() == 5);
+
+  ctx->setVariable("right", get_value<double>(0.5));
+  BOOST_TEST(expr.exec(ctx)->getReal() == 2.5);
+
+  ctx->setVariable("left", get_value<std::string>("a"));
+  ctx->setVariable("right", get_value<std::string>("b"));
+  BOOST_TEST(expr.exec(ctx)->getStr() == "ab");
+
+  ctx->setVariable("right", get_value<int64_t>(3L));
+  BOOST_CHECK_THROW(expr.exec(ctx), OperandsTypesNotCompatible);
+}
+
+BOOST_AUTO_TEST_CASE(test_compare_types_change) {
+  auto ctx = empty_context();
+  CompareExpr cmp(CompareExpr::Type::Less,
+                  constant_expr(std::make_unique<Variable>("left")),
+                  constant_expr(std::make_unique<Variable>("right")));
+
+  ctx->setVariable("left", get_value<int64_t>(2L));
+  ctx->setVariable("right", get_value<int64_t>(3L));
+  BOOST_TEST(cmp.exec(ctx)->getBool() == true);
+  BOOST_TEST(cmp.exec(ctx)->getBool() == true);
+
+  ctx->setVariable("right", get_value<double>(1.5));
+  BOOST_TEST(cmp.exec(ctx)->getBool() == false);
+
+  ctx->setVariable("left", get_value<std::string>("a"));
+  ctx->setVariable("right", get_value<std::string>("b"));
+  BOOST_TEST(cmp.exec(ctx)->getBool() == true);
+
+  ctx->setVariable("right", get_value<int64_t>(3L));
+  BOOST_CHECK_THROW(cmp.exec(ctx), TypesNotComparable);
+}
+
 BOOST_AUTO_TEST_CASE(test_compare_incomparable_types) {
   for (auto type : {CompareExpr::Type::Greater, CompareExpr::Type::GreaterEq,
                     CompareExpr::Type::Less, CompareExpr::Type::LessEq}) {
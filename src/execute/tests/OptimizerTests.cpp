@@ -0,0 +1,120 @@
+// Copyright 2019 Kamil Mankowski
+
+#include <sstream>
+
+#include <boost/test/unit_test.hpp>
+
+#include "../../parser/Parser.h"
+#include "../Optimizer.h"
+
+BOOST_AUTO_TEST_SUITE(OptimizerTest)
+
+std::string optimized(const std::string &code, std::size_t expectedCount) {
+  std::stringstream input(code);
+  Parser parser(input);
+  auto parsed = parser.parse();
+  Optimizer optimizer;
+  optimizer.optimize(*parsed);
+  BOOST_TEST(optimizer.rewrittenCount() == expectedCount);
+  auto str = parsed->toString();
+  return std::regex_replace(str, std::regex("(^|\n)  "), "$1");
+}
+
+BOOST_AUTO_TEST_CASE(test_fold_constant_expression) {
+  BOOST_TEST(optimized("e = 23 * 7 + 5 ^ 4 - 3", 3) == "e = 783");
+  BOOST_TEST(optimized("e = 1.5 * 2", 1) == "e = 3.000000");
+  BOOST_TEST(optimized("e = \"a\" + \"b\" * 2", 2) == "e = \"abb\"");
+  BOOST_TEST(optimized("e = [1] + [2]", 1) == "e = [1, 2]");
+}
+
+BOOST_AUTO_TEST_CASE(test_fold_only_leading_operands) {
+  BOOST_TEST(optimized("e = 2 * 3 + x + 1 + 2", 1) == "e = 6 + x + 1 + 2");
+}
+
+BOOST_AUTO_TEST_CASE(test_fold_compare) {
+  BOOST_TEST(optimized("if 2 * 3 > 5:\n  a = 1", 2) == "if True:\n  a = 1");
+  BOOST_TEST(optimized("while 1 == \"a\":\n  a = 1", 1) ==
+             "while False:\n  a = 1");
+}
+
+BOOST_AUTO_TEST_CASE(test_errors_not_folded) {
+  BOOST_TEST(optimized("e = 1 / 0", 0) == "e = 1 / 0");
+  BOOST_TEST(optimized("e = \"a\" - 1", 0) == "e = \"a\" - 1");
+  BOOST_TEST(optimized("if None < 1:\n  a = 1", 0) == "if None < 1:\n  a = 1");
+}
+
+BOOST_AUTO_TEST_CASE(test_identities_of_numbers) {
+  BOOST_TEST(optimized("e = x - y + 0", 1) == "e = x - y");
+  BOOST_TEST(optimized("e = x ^ 2 ^ 1 * 1", 2) == "e = x ^ 2");
+  BOOST_TEST(optimized("e = x + 0", 0) == "e = x + 0");
+  BOOST_TEST(optimized("e = x * 1", 0) == "e = x * 1");
+  BOOST_TEST(optimized("e = x + 2 * 1", 1) == "e = x + 2");
+}
+
+BOOST_AUTO_TEST_CASE(test_fold_in_nested_code) {
+  std::string code =
+      "def f(a):\n"
+      "  return 2 * 3 * a";
+  BOOST_TEST(optimized(code, 1) == "def f(a):\n  return 6 * a");
+}
+
+std::string inlined(const std::string &code, std::size_t inlineSize = 16) {
+  std::stringstream input(code);
+  Parser parser(input);
+  auto parsed = parser.parse();
+  Optimizer optimizer(nullptr, inlineSize);
+  optimizer.optimize(*parsed);
+  auto str = parsed->toString();
+  str = str.substr(str.rfind('\n') + 1);
+  return str.substr(str.find_first_not_of(' '));
+}
+
+BOOST_AUTO_TEST_CASE(test_inline_small_function) {
+  std::string code =
+      "def plus_two(inp):\n"
+      "  inp += 2\n"
+      "  return inp\n"
+      "x = plus_two(i) * 2";
+  BOOST_TEST(inlined(code) ==
+             "x = {plus_two.inp = i; plus_two.inp += 2; "
+             "return plus_two.inp} * 2");
+  BOOST_TEST(inlined(code, 0) == "x = plus_two(i) * 2");
+  BOOST_TEST(inlined(code, 2) == "x = plus_two(i) * 2");
+}
+
+BOOST_AUTO_TEST_CASE(test_inline_only_safe_functions) {
+  std::string before =
+      "def g(y):\n  return f(y)\ndef f(x):\n  return x\nb = g(1)";
+  BOOST_TEST(inlined(before) == "b = g(1)");
+
+  BOOST_TEST(inlined("def f(x):\n  return f(x)\nf(1)") == "f(1)");
+  BOOST_TEST(inlined("def f(x):\n  return x + y\nf(1)") == "f(1)");
+  BOOST_TEST(inlined("def f(x):\n  y += x\n  return y\nf(1)") == "f(1)");
+  BOOST_TEST(inlined("def f(x):\n  return x\nf(1, 2)") == "f(1, 2)");
+  BOOST_TEST(inlined("def f(x):\n  if x:\n    return 1\n  return 2\nf(1)") ==
+             "f(1)");
+  BOOST_TEST(inlined("def f(x):\n  return x\ndef f(x):\n  return 1\nf(1)") ==
+             "f(1)");
+  BOOST_TEST(inlined("if a:\n  def f(x):\n    return x\nf(1)") == "f(1)");
+}
+
+BOOST_AUTO_TEST_CASE(test_inline_calls_builtin) {
+  std::string code = "def f(x):\n  print(x)\n  return len(x)\nf(\"ab\")";
+  BOOST_TEST(inlined(code) ==
+             "{f.x = \"ab\"; print(f.x); return len(f.x)}");
+}
+
+BOOST_AUTO_TEST_CASE(test_report_to_log) {
+  std::stringstream input("e = 2 * 3 - 1");
+  std::stringstream log;
+  Parser parser(input);
+  auto parsed = parser.parse();
+  Optimizer optimizer(&log);
+  optimizer.optimize(*parsed);
+
+  BOOST_TEST(log.str() ==
+             "optimized: 2 * 3 => 6\n"
+             "optimized: 6 - 1 => 5\n");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
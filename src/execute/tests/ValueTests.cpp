@@ -24,4 +24,113 @@ BOOST_AUTO_TEST_CASE(test_list_element_can_be_changed) {
   BOOST_TEST(newref[1]->getInt() == 22L);
 }
 
+BOOST_AUTO_TEST_CASE(test_copy_owns_payload) {
+  Value str(std::string{"test"});
+  Value copy(str);
+  copy.setStr("other");
+
+  BOOST_TEST(str.getStr() == "test");
+  BOOST_TEST(copy.getStr() == "other");
+
+  std::vector<std::shared_ptr<Value>> elements{std::make_shared<Value>(1L)};
+  Value list(elements);
+  Value listCopy(std::string{"to override"});
+  listCopy = list;
+  list = Value(2L);
+
+  BOOST_TEST((list.getType() == ValueType::Int));
+  BOOST_TEST(listCopy.getList().size() == 1);
+  BOOST_TEST(listCopy.getList()[0]->getInt() == 1L);
+}
+
+BOOST_AUTO_TEST_CASE(test_setter_changes_type) {
+  Value val(std::string{"test"});
+
+  val.setInt(5L);
+  BOOST_TEST((val.getType() == ValueType::Int));
+  BOOST_TEST(val.getInt() == 5L);
+  BOOST_TEST(val.getStr() == "");
+
+  val.setReal(1.5);
+  BOOST_TEST((val.getType() == ValueType::Real));
+  BOOST_TEST(val.getReal() == 1.5);
+
+  val.setStr("again");
+  BOOST_TEST((val.getType() == ValueType::Text));
+  BOOST_TEST(val.getStr() == "again");
+}
+
+BOOST_AUTO_TEST_CASE(test_move_takes_payload) {
+  Value text(std::string("moved"));
+  Value moved(std::move(text));
+
+  BOOST_TEST(moved.getStr() == "moved");
+  BOOST_TEST((text.getType() == ValueType::None));
+  BOOST_TEST(text.getStr() == "");
+}
+
+BOOST_AUTO_TEST_CASE(test_payload_accessed_in_place) {
+  std::vector<std::shared_ptr<Value>> elements{std::make_shared<Value>(1L),
+                                               std::make_shared<Value>(2L)};
+  Value list(elements);
+  Value str(std::string{"abc"});
+
+  BOOST_TEST(&list.getList() == &list.getList());
+  BOOST_TEST(&str.getStr() == &str.getStr());
+  BOOST_TEST(list.size() == 2);
+  BOOST_TEST(str.size() == 3);
+  BOOST_TEST(Value(5L).size() == 0);
+  BOOST_TEST(Value(5L).getList().empty());
+}
+
+BOOST_AUTO_TEST_CASE(test_list_copy_shares_elements) {
+  std::vector<std::shared_ptr<Value>> elements{std::make_shared<Value>(1L)};
+  Value list(std::move(elements));
+  Value listCopy(list);
+
+  BOOST_TEST(&list.getList() == &listCopy.getList());
+}
+
+BOOST_AUTO_TEST_CASE(test_list_copied_on_write) {
+  std::vector<std::shared_ptr<Value>> elements{std::make_shared<Value>(1L)};
+  Value list(std::move(elements));
+  Value listCopy(list);
+
+  listCopy.getMutableList().push_back(std::make_shared<Value>(2L));
+
+  BOOST_TEST(list.getList().size() == 1);
+  BOOST_TEST(listCopy.getList().size() == 2);
+  BOOST_TEST(list.getList()[0] == listCopy.getList()[0]);
+
+  auto &owned = listCopy.getMutableList();
+  BOOST_TEST(&owned == &listCopy.getList());
+}
+
+BOOST_AUTO_TEST_CASE(test_mutable_range_materialized) {
+  Value range(Value::Range{2, 3, 2});
+  range.getMutableList().push_back(std::make_shared<Value>(1L));
+
+  BOOST_TEST(!range.isRange());
+  BOOST_TEST(range.toString() == "[2, 5, 1]");
+}
+
+BOOST_AUTO_TEST_CASE(test_singletons_shared) {
+  BOOST_TEST(Value::makeNone() == Value::makeNone());
+  BOOST_TEST((Value::makeNone()->getType() == ValueType::None));
+  BOOST_TEST(Value::makeBool(true) == Value::makeBool(true));
+  BOOST_TEST(Value::makeBool(true)->getBool() == true);
+  BOOST_TEST(Value::makeBool(false)->getBool() == false);
+}
+
+BOOST_AUTO_TEST_CASE(test_small_integers_cached) {
+  BOOST_TEST(Value::makeInt(-256) == Value::makeInt(-256));
+  BOOST_TEST(Value::makeInt(65535) == Value::makeInt(65535));
+  BOOST_TEST(Value::makeInt(7)->getInt() == 7L);
+
+  auto big = Value::makeInt(65536);
+  BOOST_TEST(big != Value::makeInt(65536));
+  BOOST_TEST(big->getInt() == 65536L);
+  BOOST_TEST(Value::makeInt(-257)->getInt() == -257L);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
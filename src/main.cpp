@@ -1,14 +1,70 @@
 // Copyright 2019 Kamil Mankowski
 
+#include <cstdlib>
 #include <iomanip>
 #include <iostream>
 
+#include <memory>
 #include <sstream>
+#include <stdexcept>
 #include <string>
 
 #include "Program.h"
+#include "scanner/MappedFile.h"
+
+namespace {
+
+// Value of `--option=N`, false when the argument is not that option.
+// Exits when the value is not a number.
+bool sizeOption(const std::string &arg, const std::string &option,
+                std::size_t &value) {
+  auto prefix = option + "=";
+  if (arg.compare(0, prefix.size(), prefix) != 0) return false;
+  auto number = arg.substr(prefix.size());
+  if (number.empty() || number.size() > 18 ||
+      number.find_first_not_of("0123456789") != std::string::npos) {
+    std::cerr << "Invalid value of " << option << ": " << number << std::endl;
+    std::exit(1);
+  }
+  value = std::stoull(number);
+  return true;
+}
+
+// Reads tokens of the input without parsing it, for measuring the scanner
+void scanOnly(Scanner &scanner) {
+  std::size_t count = 0;
+  while (scanner.getNextToken().getType() != Token::Type::eof) ++count;
+  std::cout << count << " tokens" << std::endl;
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  auto engine = Program::Engine::TreeWalker;
+  bool debugOptimizer = false;
+  std::size_t inlineSize = Optimizer::defaultInlineSize;
+  std::size_t maxDepth = 0;
+  bool scan = false;
+  std::string path;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--vm") {
+      engine = Program::Engine::Bytecode;
+    } else if (arg == "--debug-optimizer") {
+      debugOptimizer = true;
+    } else if (arg == "--scan-only") {
+      scan = true;
+    } else if (sizeOption(arg, "--inline-size", inlineSize) ||
+               sizeOption(arg, "--max-depth", maxDepth)) {
+      continue;
+    } else if (arg.compare(0, 2, "--") != 0 && path.empty()) {
+      path = arg;
+    } else {
+      std::cerr << "Unknown option: " << arg << std::endl;
+      return 1;
+    }
+  }
 
-int main() {
   // std::string program = "v3 = val[1]";
   // std::cout << program << std::endl;
   // std::stringstream input(program);
@@ -19,8 +75,37 @@ int main() {
   // std::cout << "PARSING END" << std::endl;
   // std::cout << parsed.codeToString();
 
-  Program program(std::cin, std::cout);
-  program.run();
+  // Script given by path is mapped, not read, otherwise it is read from
+  // the standard input
+  std::unique_ptr<MappedFile> file;
+  if (!path.empty()) {
+    try {
+      file = std::make_unique<MappedFile>(path);
+    } catch (const std::runtime_error &e) {
+      std::cerr << e.what() << std::endl;
+      return 1;
+    }
+  }
+
+  if (scan) {
+    if (file != nullptr) {
+      Scanner scanner(file->begin(), file->end());
+      scanOnly(scanner);
+    } else {
+      Scanner scanner(std::cin);
+      scanOnly(scanner);
+    }
+    return 0;
+  }
+
+  auto program = file != nullptr
+                     ? std::make_unique<Program>(file->begin(), file->end(),
+                                                 std::cout, engine)
+                     : std::make_unique<Program>(std::cin, std::cout, engine);
+  if (debugOptimizer) program->setOptimizerLog(&std::cerr);
+  program->setInlineSize(inlineSize);
+  program->setMaxDepth(maxDepth);
+  program->run();
 
   // input.seekg(0);
   // Scanner scan(input);
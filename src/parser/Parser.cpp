@@ -95,14 +95,18 @@ std::unique_ptr<CodeBlock> Parser::parseCodeBlock(int width, bool inFunc,
 
 std::unique_ptr<Return> Parser::parseReturn() {
   auto returnInstr = std::make_unique<Return>();
+  std::unique_ptr<CompareExpr> cmpPtr;
   std::unique_ptr<Instruction> instrPtr;
 
   getNextToken();
   if (checkTokenType(InstrEnd)) {
     returnInstr->setValue(std::make_unique<Constant>(ValueType::None));
     getNextToken();
-  } else if ((instrPtr = tryParseCmpExpr(ttype::nl)) != nullptr) {
-    returnInstr->setValue(std::move(instrPtr));
+  } else if ((cmpPtr = tryParseCmpExpr(ttype::nl)) != nullptr) {
+    if (cmpPtr->isComparison())
+      returnInstr->setValue(std::move(cmpPtr));
+    else
+      returnInstr->setValue(cmpPtr->releaseOperand());
   } else if ((instrPtr = tryParseExpr()) != nullptr) {
     returnInstr->setValue(std::move(instrPtr));
   } else {
@@ -164,9 +168,10 @@ std::unique_ptr<Constant> Parser::tryParseConstant() {
   return constPtr;
 }
 
-std::unique_ptr<Expression> Parser::tryParseExpr() {
+std::unique_ptr<Instruction> Parser::tryParseExpr() {
   auto leftMul = tryParseExprMul();
   if (leftMul == nullptr) return nullptr;
+  if (!checkTokenType(OperatorsAddSub)) return leftMul;
   auto expr = std::make_unique<Expression>();
   expr->setArgument(std::move(leftMul));
 
@@ -182,9 +187,10 @@ std::unique_ptr<Expression> Parser::tryParseExpr() {
   return std::move(expr);
 }
 
-std::unique_ptr<Expression> Parser::tryParseExprMul() {
+std::unique_ptr<Instruction> Parser::tryParseExprMul() {
   auto left = tryParseExprExp();
   if (left == nullptr) return nullptr;
+  if (!checkTokenType(OperatorsMulDiv)) return left;
   auto expr = std::make_unique<Expression>();
   expr->setArgument(std::move(left));
 
@@ -201,9 +207,10 @@ std::unique_ptr<Expression> Parser::tryParseExprMul() {
   return std::move(expr);
 }
 
-std::unique_ptr<Expression> Parser::tryParseExprExp() {
+std::unique_ptr<Instruction> Parser::tryParseExprExp() {
   auto left = tryParseArgument();
   if (left == nullptr) return nullptr;
+  if (!checkTokenType(ttype::expOp)) return left;
   auto expr = std::make_unique<Expression>();
   expr->setArgument(std::move(left));
 
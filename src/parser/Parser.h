@@ -31,6 +31,7 @@ enum ExpectedTokens {
 class Parser {
  public:
   explicit Parser(std::istream &in) : scanner(in) {}
+  Parser(const char *begin, const char *end) : scanner(begin, end) {}
   std::unique_ptr<CodeBlock> parse();
 
  private:
@@ -63,9 +64,10 @@ class Parser {
 
   std::unique_ptr<CompareExpr> tryParseCmpExpr(
       ttype expectedEnd = ttype::colon);
-  std::unique_ptr<Expression> tryParseExpr();
-  std::unique_ptr<Expression> tryParseExprMul();
-  std::unique_ptr<Expression> tryParseExprExp();
+  // Operand alone is returned without the Expression around it
+  std::unique_ptr<Instruction> tryParseExpr();
+  std::unique_ptr<Instruction> tryParseExprMul();
+  std::unique_ptr<Instruction> tryParseExprExp();
   std::unique_ptr<AssignExpr> tryParseAssignExpr();
   std::unique_ptr<If> tryParseIfExpr(int width, bool inFunction, bool inLoop);
   std::unique_ptr<For> tryParseForLoop(int width, bool inFunction);
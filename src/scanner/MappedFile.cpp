@@ -0,0 +1,55 @@
+// Copyright 2019 Kamil Mankowski
+
+#include "MappedFile.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+std::runtime_error fileError(const std::string &path) {
+  return std::runtime_error("Cannot read " + path + ": " +
+                            std::strerror(errno));
+}
+
+}  // namespace
+
+MappedFile::MappedFile(const std::string &path) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) throw fileError(path);
+
+  struct stat info;
+  if (fstat(fd, &info) != 0) {
+    auto error = fileError(path);
+    close(fd);
+    throw error;
+  }
+  if (!S_ISREG(info.st_mode)) {
+    close(fd);
+    throw std::runtime_error("Cannot read " + path + ": not a regular file");
+  }
+
+  // Empty file cannot be mapped, it is scanned as an empty range
+  size = info.st_size;
+  if (size > 0) {
+    void *mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapping == MAP_FAILED) {
+      auto error = fileError(path);
+      close(fd);
+      throw error;
+    }
+    madvise(mapping, size, MADV_SEQUENTIAL);
+    data = static_cast<const char *>(mapping);
+  }
+  close(fd);
+}
+
+MappedFile::~MappedFile() {
+  if (data != nullptr) munmap(const_cast<char *>(data), size);
+}
@@ -0,0 +1,27 @@
+// Copyright 2019 Kamil Mankowski
+
+#ifndef SRC_SCANNER_MAPPEDFILE_H_
+#define SRC_SCANNER_MAPPEDFILE_H_
+
+#include <cstddef>
+#include <string>
+
+// Whole file mapped read-only into memory, the scanner reads the source
+// directly from the mapping. Throws std::runtime_error when the file cannot
+// be opened or mapped.
+class MappedFile {
+ public:
+  explicit MappedFile(const std::string &path);
+  ~MappedFile();
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  const char *begin() const { return data; }
+  const char *end() const { return data + size; }
+
+ private:
+  const char *data = nullptr;
+  std::size_t size = 0;
+};
+
+#endif  // SRC_SCANNER_MAPPEDFILE_H_
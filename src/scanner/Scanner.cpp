@@ -2,43 +2,129 @@
 
 #include "Scanner.h"
 
-Scanner::Scanner(std::istream &in) : in(in) {
-  keywordsTokens.insert(std::make_pair("True", Token::Type::trueT));
-  keywordsTokens.insert(std::make_pair("False", Token::Type::falseT));
-  keywordsTokens.insert(std::make_pair("None", Token::Type::none));
-  keywordsTokens.insert(std::make_pair("while", Token::Type::whileT));
-  keywordsTokens.insert(std::make_pair("for", Token::Type::forT));
-  keywordsTokens.insert(std::make_pair("in", Token::Type::in));
-  keywordsTokens.insert(std::make_pair("if", Token::Type::ifT));
-  keywordsTokens.insert(std::make_pair("else", Token::Type::elseT));
-  keywordsTokens.insert(std::make_pair("continue", Token::Type::continueT));
-  keywordsTokens.insert(std::make_pair("break", Token::Type::breakT));
-  keywordsTokens.insert(std::make_pair("def", Token::Type::def));
-  keywordsTokens.insert(std::make_pair("return", Token::Type::returnT));
-
-  onlySinglePunct.insert(std::make_pair("(", Token::Type::openBracket));
-  onlySinglePunct.insert(std::make_pair(")", Token::Type::closeBracket));
-  onlySinglePunct.insert(std::make_pair("[", Token::Type::openSquareBracket));
-  onlySinglePunct.insert(std::make_pair("]", Token::Type::closeSquareBracket));
-  onlySinglePunct.insert(std::make_pair(":", Token::Type::colon));
-  onlySinglePunct.insert(std::make_pair(",", Token::Type::comma));
-  onlySinglePunct.insert(std::make_pair("*", Token::Type::multipOp));
-  onlySinglePunct.insert(std::make_pair("/", Token::Type::divOp));
-  onlySinglePunct.insert(std::make_pair("^", Token::Type::expOp));
-
-  multiCharOperators.insert(std::make_pair("=", Token::Type::assign));
-  multiCharOperators.insert(std::make_pair("+=", Token::Type::addAssign));
-  multiCharOperators.insert(std::make_pair("-=", Token::Type::subAssign));
-  multiCharOperators.insert(std::make_pair("+", Token::Type::add));
-  multiCharOperators.insert(std::make_pair("-", Token::Type::sub));
-  multiCharOperators.insert(std::make_pair("==", Token::Type::equal));
-  multiCharOperators.insert(std::make_pair(">", Token::Type::greater));
-  multiCharOperators.insert(std::make_pair("<", Token::Type::less));
-  multiCharOperators.insert(std::make_pair(">=", Token::Type::greaterEq));
-  multiCharOperators.insert(std::make_pair("<=", Token::Type::lessEq));
-  multiCharOperators.insert(std::make_pair("!=", Token::Type::diff));
+#include <cstring>
+
+#include "Skip.h"
+
+namespace {
+
+constexpr std::size_t readBlockSize = 1 << 16;
+
+// Digits are validated before, overflow wraps around
+std::int64_t parseInteger(const char *begin, const char *end, int base) {
+  std::uint64_t value = 0;
+  for (auto digit = begin; digit != end; ++digit) {
+    int c = *digit;
+    int digitValue = c <= '9' ? c - '0' : (c | 0x20) - 'a' + 10;
+    value = value * base + digitValue;
+  }
+  return static_cast<std::int64_t>(value);
 }
 
+std::string readSource(std::istream &in) {
+  std::string source;
+  std::size_t size = 0;
+  do {
+    source.resize(size + readBlockSize);
+    in.read(&source[size], readBlockSize);
+    size += in.gcount();
+  } while (in);
+  if (in.bad()) throw std::runtime_error("Error on source reading!");
+  source.resize(size);
+  return source;
+}
+
+struct Keyword {
+  const char *text;
+  std::size_t length;
+  Token::Type type;
+};
+
+constexpr Keyword keywordsList[] = {
+    {"True", 4, Token::Type::trueT},
+    {"False", 5, Token::Type::falseT},
+    {"None", 4, Token::Type::none},
+    {"while", 5, Token::Type::whileT},
+    {"for", 3, Token::Type::forT},
+    {"in", 2, Token::Type::in},
+    {"if", 2, Token::Type::ifT},
+    {"else", 4, Token::Type::elseT},
+    {"continue", 8, Token::Type::continueT},
+    {"break", 5, Token::Type::breakT},
+    {"def", 3, Token::Type::def},
+    {"return", 6, Token::Type::returnT}};
+
+// Perfect hash of the keywords: each of them has a different value, so one
+// comparison tells if the identifier is a keyword
+constexpr std::size_t keywordHash(const char *text, std::size_t length) {
+  return (3 * static_cast<unsigned char>(text[0]) +
+          7 * static_cast<unsigned char>(text[length - 1]) + length) &
+         31;
+}
+
+struct KeywordsTable {
+  Keyword entries[32];
+  bool collision;
+};
+
+constexpr KeywordsTable makeKeywordsTable() {
+  KeywordsTable table{};
+  for (auto &keyword : keywordsList) {
+    auto &entry = table.entries[keywordHash(keyword.text, keyword.length)];
+    if (entry.text != nullptr) table.collision = true;
+    entry = keyword;
+  }
+  return table;
+}
+
+constexpr KeywordsTable keywordsTable = makeKeywordsTable();
+static_assert(!keywordsTable.collision, "Keywords hash is not perfect");
+
+// Tokens of the punctuation character alone and followed by `=`. Character
+// without the latter is never joined with `=`.
+struct Punctuation {
+  Token::Type alone;
+  Token::Type withAssign;
+};
+
+struct PunctuationTable {
+  Punctuation of[256];
+};
+
+constexpr PunctuationTable makePunctuationTable() {
+  PunctuationTable table{};
+  for (auto &entry : table.of)
+    entry = Punctuation{Token::Type::NaT, Token::Type::NaT};
+  table.of['('].alone = Token::Type::openBracket;
+  table.of[')'].alone = Token::Type::closeBracket;
+  table.of['['].alone = Token::Type::openSquareBracket;
+  table.of[']'].alone = Token::Type::closeSquareBracket;
+  table.of[':'].alone = Token::Type::colon;
+  table.of[','].alone = Token::Type::comma;
+  table.of['*'].alone = Token::Type::multipOp;
+  table.of['/'].alone = Token::Type::divOp;
+  table.of['^'].alone = Token::Type::expOp;
+  table.of['='] = Punctuation{Token::Type::assign, Token::Type::equal};
+  table.of['+'] = Punctuation{Token::Type::add, Token::Type::addAssign};
+  table.of['-'] = Punctuation{Token::Type::sub, Token::Type::subAssign};
+  table.of['>'] = Punctuation{Token::Type::greater, Token::Type::greaterEq};
+  table.of['<'] = Punctuation{Token::Type::less, Token::Type::lessEq};
+  table.of['!'].withAssign = Token::Type::diff;
+  return table;
+}
+
+constexpr PunctuationTable punctuationTable = makePunctuationTable();
+
+}  // namespace
+
+Scanner::Scanner(std::istream &in)
+    : source(readSource(in)),
+      current(source.data()),
+      end(source.data() + source.size()) {}
+
+Scanner::Scanner(const char *begin, const char *end)
+    : current(begin), end(end) {}
+
 Token Scanner::getNextToken() {
   char nextChar;
 
@@ -49,22 +135,11 @@ Token Scanner::getNextToken() {
   if (isNewLine) return parseSpace();
   if (nextChar == EOF) return makeToken(Token::Type::eof);
   if (nextChar == '\n') return parseNewLine();
-  if (isdigit(nextChar)) return parseDigit();
+  if (validation::is(nextChar, validation::Digit)) return parseDigit();
   if (validation::isValidIdentiferChar(nextChar)) return parseAlpha();
   if (nextChar == '"') return parseQuotationMark();
-  if (ispunct(nextChar)) return parsePunct();
-  return parseUnexpectedChar();
-}
-
-char Scanner::getNextChar() {
-  if (in.eof()) return EOF;
-  if (!in) throw std::runtime_error("Error on source reading!");
-  return in.peek();
-}
-
-void Scanner::moveForward() {
-  in.get();
-  currentColumn += 1;
+  if (validation::is(nextChar, validation::Punct)) return parsePunct();
+  return parseUnexpectedChar(current);
 }
 
 void Scanner::skipWhitespaces() {
@@ -74,8 +149,7 @@ void Scanner::skipWhitespaces() {
     return;
   }
 
-  char c;
-  while ((c = getNextChar()) != '\n' && isspace(c)) moveForward();
+  moveTo(skip::spaces(current, end));
 }
 
 void Scanner::skipComment() {
@@ -83,11 +157,12 @@ void Scanner::skipComment() {
 
   if (c != '#') return;
 
-  while ((c = getNextChar()) != '\n' && c != EOF) moveForward();
+  moveTo(skip::line(current, end));
 }
 
-Token Scanner::unvalidToken(const std::string &value) {
-  return Token(Token::Type::NaT, value, currentLine, currentColumn);
+Token Scanner::unvalidToken(const char *begin) {
+  return Token(Token::Type::NaT, begin, current - begin, currentLine,
+               currentColumn);
 }
 
 Token Scanner::makeToken(Token::Type type, std::int64_t value) {
@@ -102,8 +177,9 @@ Token Scanner::makeToken(double value) {
   return Token(value, currentLine, currentLine);
 }
 
-Token Scanner::makeToken(Token::Type type, std::string str) {
-  return Token(type, str, currentLine, currentColumn);
+Token Scanner::makeToken(Token::Type type, const char *begin,
+                         std::size_t length) {
+  return Token(type, begin, length, currentLine, currentColumn);
 }
 
 Token Scanner::parseNewLine() {
@@ -116,106 +192,84 @@ Token Scanner::parseNewLine() {
 }
 
 Token Scanner::parseSpace() {
-  int spacesCount = 0;
-  char c;
-
-  while ((c = getNextChar()) != '\n' && isspace(c)) {
-    ++spacesCount;
-    moveForward();
-  }
+  auto begin = current;
+  moveTo(skip::spaces(current, end));
+  int spacesCount = current - begin;
 
   isNewLine = false;
   return makeToken(Token::Type::space, spacesCount);
 }
 
 Token Scanner::parseAlpha() {
-  std::string identifer;
-  char c;
+  auto begin = current;
+  moveTo(skip::identifier(current, end));
+  std::size_t length = current - begin;
 
-  while (validation::isValidIdentiferChar((c = getNextChar()))) {
-    identifer += c;
-    moveForward();
-  }
+  auto &keyword = keywordsTable.entries[keywordHash(begin, length)];
+  if (keyword.length == length &&
+      std::memcmp(keyword.text, begin, length) == 0)
+    return makeToken(keyword.type);
 
-  auto findedKeyword = keywordsTokens.find(identifer);
-  if (findedKeyword != keywordsTokens.end())
-    return makeToken(findedKeyword->second);
-
-  return makeToken(Token::Type::identifier, identifer);
+  return makeToken(Token::Type::identifier, begin, length);
 }
 
 Token Scanner::parseDigit() {
-  std::string tmp = "";
-  char c;
-  while (isalnum(c = getNextChar())) {
-    tmp += c;
+  auto begin = current;
+  while (validation::is(getNextChar(), validation::Alnum)) moveForward();
+  if (getNextChar() == '.') {
+    auto point = current;
     moveForward();
+    while (validation::is(getNextChar(), validation::Alnum)) moveForward();
+    // Short text of the number fits in the string without allocation
+    if (validation::isValidRealNumber(begin, current, point))
+      return makeToken(std::stod(std::string(begin, current)));
   }
-  if (c == '.') {
-    int pointerPosition = tmp.size();
-    tmp += c;
-    moveForward();
-    while (isalnum(c = getNextChar())) {
-      tmp += c;
-      moveForward();
-    }
-    if (validation::isValidRealNumber(tmp, pointerPosition))
-      return makeToken(std::stod(tmp));
-  }
-  if (tmp.size() > 2 && tmp.substr(0, 2) == "0x") {
-    std::string onlyNumber = tmp.substr(2, tmp.size());
-    if (validation::isValidHexNumber(onlyNumber))
-      return makeToken(Token::Type::integerNumber,
-                       std::stoll(onlyNumber, 0, 16));
-  }
-  if (validation::isValidIntegerNumber(tmp))
-    return makeToken(Token::Type::integerNumber, std::stoi(tmp));
-  return unvalidToken(tmp);
+  if (current - begin > 2 && begin[0] == '0' && begin[1] == 'x' &&
+      validation::isValidHexNumber(begin + 2, current))
+    return makeToken(Token::Type::integerNumber,
+                     parseInteger(begin + 2, current, 16));
+  if (validation::isValidIntegerNumber(begin, current))
+    return makeToken(Token::Type::integerNumber,
+                     parseInteger(begin, current, 10));
+  return unvalidToken(begin);
 }
 
 Token Scanner::parsePunct() {
-  std::string tmp = "";
-  tmp += getNextChar();
+  auto begin = current;
+  char first = getNextChar();
   moveForward();
 
-  auto findedToken = onlySinglePunct.find(tmp);
-  if (findedToken != onlySinglePunct.end())
-    return makeToken(findedToken->second);
+  auto &punctuation = punctuationTable.of[static_cast<unsigned char>(first)];
+  if (punctuation.withAssign == Token::Type::NaT &&
+      punctuation.alone != Token::Type::NaT)
+    return makeToken(punctuation.alone);
 
   if (getNextChar() == '=') {
-    tmp += '=';
     moveForward();
+    if (punctuation.withAssign != Token::Type::NaT)
+      return makeToken(punctuation.withAssign);
+    return parseUnexpectedChar(begin);
   }
 
-  findedToken = multiCharOperators.find(tmp);
-  if (findedToken != multiCharOperators.end())
-    return makeToken(findedToken->second);
-
-  return parseUnexpectedChar(tmp);
+  if (punctuation.alone != Token::Type::NaT)
+    return makeToken(punctuation.alone);
+  return parseUnexpectedChar(begin);
 }
 
 Token Scanner::parseQuotationMark() {
-  std::string tmp = "";
-  char c;
-
   moveForward();
-  while ((c = getNextChar()) != '"' && c != '\n' && c != EOF) {
-    tmp += c;
-    moveForward();
-  }
+  auto begin = current;
+  moveTo(skip::text(current, end));
 
-  if (c != '"') return unvalidToken(tmp);
+  if (getNextChar() != '"') return unvalidToken(begin);
 
+  std::size_t length = current - begin;
   moveForward();
-  return makeToken(Token::Type::stringT, tmp);
+  return makeToken(Token::Type::stringT, begin, length);
 }
 
-Token Scanner::parseUnexpectedChar(std::string start) {
-  char c;
-
-  while (isgraph(c = getNextChar())) {
-    start += c;
-    moveForward();
-  }
-  return unvalidToken(start);
+// Token starts at `begin`, the scanner may already be past its first chars
+Token Scanner::parseUnexpectedChar(const char *begin) {
+  while (validation::is(getNextChar(), validation::Graph)) moveForward();
+  return unvalidToken(begin);
 }
@@ -3,40 +3,54 @@
 #ifndef SRC_SCANNER_SCANNER_H_
 #define SRC_SCANNER_SCANNER_H_
 
-#include <cctype>
+#include <cstdio>
 #include <istream>
-#include <map>
 #include <stdexcept>
 #include <string>
 
 #include "Token.h"
 #include "Validation.h"
 
+// Source is read from the stream at once in large blocks and scanned from
+// the buffer, so reading a character costs no stream call.
 class Scanner {
  public:
   explicit Scanner(std::istream &in);
+  // Scans the source in place (e.g. MappedFile), it has to outlive the
+  // scanner
+  Scanner(const char *begin, const char *end);
+  Scanner(const Scanner &) = delete;
+  Scanner &operator=(const Scanner &) = delete;
 
   Token getNextToken();
 
  private:
-  std::istream &in;
+  std::string source;
+  const char *current;
+  const char *end;
   bool isNewLine = true;  // Begin of the new line
   int currentLine = 1;
   int currentColumn = 0;
-  std::map<std::string, Token::Type> keywordsTokens;
-  std::map<std::string, Token::Type> onlySinglePunct;
-  std::map<std::string, Token::Type> multiCharOperators;
 
-  char getNextChar();
-  void moveForward();
+  char getNextChar() const { return current != end ? *current : EOF; }
+  void moveForward() {
+    ++current;
+    currentColumn += 1;
+  }
+  // Moves over the run of characters without a new line
+  void moveTo(const char *position) {
+    currentColumn += position - current;
+    current = position;
+  }
   void skipWhitespaces();
   void skipComment();
 
-  Token unvalidToken(const std::string &value);
+  // Text of tokens points into the source, see Token
+  Token unvalidToken(const char *begin);
   Token makeToken(Token::Type type, std::int64_t value);
   Token makeToken(Token::Type type);
   Token makeToken(double value);
-  Token makeToken(Token::Type type, std::string str);
+  Token makeToken(Token::Type type, const char *begin, std::size_t length);
 
   Token parseNewLine();
   Token parseSpace();
@@ -44,7 +58,7 @@ class Scanner {
   Token parseDigit();
   Token parsePunct();
   Token parseQuotationMark();
-  Token parseUnexpectedChar(std::string start = "");
+  Token parseUnexpectedChar(const char *begin);
 };
 
 #endif  // SRC_SCANNER_SCANNER_H_
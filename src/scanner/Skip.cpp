@@ -0,0 +1,167 @@
+// Copyright 2019 Kamil Mankowski
+
+#include "Skip.h"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define SKIP_X86 1
+#endif
+
+#include "Validation.h"
+
+namespace skip {
+
+namespace {
+
+const char *spacesScalar(const char *begin, const char *end) {
+  while (begin != end && *begin != '\n' &&
+         validation::is(*begin, validation::Space))
+    ++begin;
+  return begin;
+}
+
+const char *identifierScalar(const char *begin, const char *end) {
+  while (begin != end && validation::isValidIdentiferChar(*begin)) ++begin;
+  return begin;
+}
+
+const char *lineScalar(const char *begin, const char *end) {
+  while (begin != end && *begin != '\n') ++begin;
+  return begin;
+}
+
+const char *textScalar(const char *begin, const char *end) {
+  while (begin != end && *begin != '"' && *begin != '\n') ++begin;
+  return begin;
+}
+
+const Functions scalar = {"scalar", spacesScalar, identifierScalar,
+                          lineScalar, textScalar};
+
+#ifdef SKIP_X86
+
+// Masks have a bit set for each character which ends the run. Bytes above
+// 127 are negative in the signed comparisons, so they are in no range.
+
+inline unsigned stopSpaces(__m128i chars) {
+  auto control = _mm_and_si128(_mm_cmpgt_epi8(chars, _mm_set1_epi8('\t' - 1)),
+                               _mm_cmplt_epi8(chars, _mm_set1_epi8('\r' + 1)));
+  auto space = _mm_or_si128(
+      _mm_andnot_si128(_mm_cmpeq_epi8(chars, _mm_set1_epi8('\n')), control),
+      _mm_cmpeq_epi8(chars, _mm_set1_epi8(' ')));
+  return ~_mm_movemask_epi8(space) & 0xFFFF;
+}
+
+inline unsigned stopIdentifier(__m128i chars) {
+  auto lower = _mm_or_si128(chars, _mm_set1_epi8(0x20));
+  auto letter = _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)),
+                              _mm_cmplt_epi8(lower, _mm_set1_epi8('z' + 1)));
+  auto digit = _mm_and_si128(_mm_cmpgt_epi8(chars, _mm_set1_epi8('0' - 1)),
+                             _mm_cmplt_epi8(chars, _mm_set1_epi8('9' + 1)));
+  auto underscore = _mm_cmpeq_epi8(chars, _mm_set1_epi8('_'));
+  auto valid = _mm_or_si128(_mm_or_si128(letter, digit), underscore);
+  return ~_mm_movemask_epi8(valid) & 0xFFFF;
+}
+
+inline unsigned stopLine(__m128i chars) {
+  return _mm_movemask_epi8(_mm_cmpeq_epi8(chars, _mm_set1_epi8('\n')));
+}
+
+inline unsigned stopText(__m128i chars) {
+  return _mm_movemask_epi8(
+      _mm_or_si128(_mm_cmpeq_epi8(chars, _mm_set1_epi8('"')),
+                   _mm_cmpeq_epi8(chars, _mm_set1_epi8('\n'))));
+}
+
+template <unsigned (*stop)(__m128i),
+          const char *(*finish)(const char *, const char *)>
+const char *runSse2(const char *begin, const char *end) {
+  for (; end - begin >= 16; begin += 16) {
+    auto chars = _mm_loadu_si128(reinterpret_cast<const __m128i *>(begin));
+    auto mask = stop(chars);
+    if (mask != 0) return begin + __builtin_ctz(mask);
+  }
+  return finish(begin, end);
+}
+
+const Functions sse2 = {"sse2", runSse2<stopSpaces, spacesScalar>,
+                        runSse2<stopIdentifier, identifierScalar>,
+                        runSse2<stopLine, lineScalar>,
+                        runSse2<stopText, textScalar>};
+
+// AVX2 versions are compiled for the instruction set regardless of the
+// build flags and used only when the CPU reports it
+
+#define SKIP_AVX2 __attribute__((target("avx2")))
+
+SKIP_AVX2 inline unsigned stopSpaces(__m256i chars) {
+  auto control =
+      _mm256_and_si256(_mm256_cmpgt_epi8(chars, _mm256_set1_epi8('\t' - 1)),
+                       _mm256_cmpgt_epi8(_mm256_set1_epi8('\r' + 1), chars));
+  auto space = _mm256_or_si256(
+      _mm256_andnot_si256(_mm256_cmpeq_epi8(chars, _mm256_set1_epi8('\n')),
+                          control),
+      _mm256_cmpeq_epi8(chars, _mm256_set1_epi8(' ')));
+  return ~static_cast<unsigned>(_mm256_movemask_epi8(space));
+}
+
+SKIP_AVX2 inline unsigned stopIdentifier(__m256i chars) {
+  auto lower = _mm256_or_si256(chars, _mm256_set1_epi8(0x20));
+  auto letter =
+      _mm256_and_si256(_mm256_cmpgt_epi8(lower, _mm256_set1_epi8('a' - 1)),
+                       _mm256_cmpgt_epi8(_mm256_set1_epi8('z' + 1), lower));
+  auto digit =
+      _mm256_and_si256(_mm256_cmpgt_epi8(chars, _mm256_set1_epi8('0' - 1)),
+                       _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), chars));
+  auto underscore = _mm256_cmpeq_epi8(chars, _mm256_set1_epi8('_'));
+  auto valid = _mm256_or_si256(_mm256_or_si256(letter, digit), underscore);
+  return ~static_cast<unsigned>(_mm256_movemask_epi8(valid));
+}
+
+SKIP_AVX2 inline unsigned stopLine(__m256i chars) {
+  return _mm256_movemask_epi8(
+      _mm256_cmpeq_epi8(chars, _mm256_set1_epi8('\n')));
+}
+
+SKIP_AVX2 inline unsigned stopText(__m256i chars) {
+  return _mm256_movemask_epi8(
+      _mm256_or_si256(_mm256_cmpeq_epi8(chars, _mm256_set1_epi8('"')),
+                      _mm256_cmpeq_epi8(chars, _mm256_set1_epi8('\n'))));
+}
+
+// Shorter rest is checked by the SSE2 version
+template <unsigned (*stop)(__m256i),
+          const char *(*finish)(const char *, const char *)>
+SKIP_AVX2 const char *runAvx2(const char *begin, const char *end) {
+  for (; end - begin >= 32; begin += 32) {
+    auto chars = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(begin));
+    auto mask = stop(chars);
+    if (mask != 0) return begin + __builtin_ctz(mask);
+  }
+  return finish(begin, end);
+}
+
+const Functions avx2 = {
+    "avx2", runAvx2<stopSpaces, runSse2<stopSpaces, spacesScalar>>,
+    runAvx2<stopIdentifier, runSse2<stopIdentifier, identifierScalar>>,
+    runAvx2<stopLine, runSse2<stopLine, lineScalar>>,
+    runAvx2<stopText, runSse2<stopText, textScalar>>};
+
+#endif  // SKIP_X86
+
+}  // namespace
+
+std::vector<const Functions *> available() {
+  std::vector<const Functions *> functions;
+#ifdef SKIP_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) functions.push_back(&avx2);
+  functions.push_back(&sse2);
+#endif
+  functions.push_back(&scalar);
+  return functions;
+}
+
+const Functions &selected = *available().front();
+
+}  // namespace skip
@@ -0,0 +1,67 @@
+// Copyright 2019 Kamil Mankowski
+
+#ifndef SRC_SCANNER_SKIP_H_
+#define SRC_SCANNER_SKIP_H_
+
+#include <cstddef>
+#include <vector>
+
+#include "Validation.h"
+
+// Finding the end of runs of characters of one class in the source. Each
+// function returns the first character after the run beginning at `begin`,
+// or `end`. Where the CPU supports it, 16 or 32 characters are checked at
+// a time; the implementation is selected when the program starts.
+namespace skip {
+
+struct Functions {
+  const char *name;
+  // Whitespaces other than the new line
+  const char *(*spaces)(const char *begin, const char *end);
+  const char *(*identifier)(const char *begin, const char *end);
+  // Up to the new line, for comments
+  const char *(*line)(const char *begin, const char *end);
+  // Up to the quotation mark or the new line, for strings
+  const char *(*text)(const char *begin, const char *end);
+};
+
+// Implementations supported by the CPU, the scalar one is always the last
+std::vector<const Functions *> available();
+
+extern const Functions &selected;
+
+// Most runs (spaces between tokens, names) are short, their first
+// characters are checked in place and only longer runs use the selected
+// implementation
+constexpr std::ptrdiff_t shortRun = 16;
+
+template <typename InRun>
+inline const char *run(const char *begin, const char *end, InRun inRun,
+                       const char *(*longRun)(const char *, const char *)) {
+  auto limit = end - begin > shortRun ? begin + shortRun : end;
+  for (; begin != limit; ++begin)
+    if (!inRun(*begin)) return begin;
+  return limit != end ? longRun(begin, end) : end;
+}
+
+inline const char *spaces(const char *begin, const char *end) {
+  return run(
+      begin, end,
+      [](char c) { return c != '\n' && validation::is(c, validation::Space); },
+      selected.spaces);
+}
+inline const char *identifier(const char *begin, const char *end) {
+  return run(begin, end, validation::isValidIdentiferChar,
+             selected.identifier);
+}
+inline const char *line(const char *begin, const char *end) {
+  return run(begin, end, [](char c) { return c != '\n'; }, selected.line);
+}
+inline const char *text(const char *begin, const char *end) {
+  return run(begin, end, [](char c) { return c != '"' && c != '\n'; },
+             selected.text);
+}
+
+}  // namespace skip
+
+#endif  // SRC_SCANNER_SKIP_H_
@@ -3,6 +3,8 @@
 #ifndef SRC_SCANNER_TOKEN_H_
 #define SRC_SCANNER_TOKEN_H_
 
+#include <cstddef>
+#include <cstdint>
 #include <string>
 
 class Token {
@@ -60,12 +62,14 @@ class Token {
         numValue({.real = value}),
         line(line),
         column(column) {}
-  Token(Type type, std::string str, int line, int column)
-      : type(type), strValue(str), line(line), column(column) {}
+  // Text is not copied, it points into the source kept by the scanner
+  Token(Type type, const char *text, std::size_t length, int line,
+        int column)
+      : type(type), text(text), length(length), line(line), column(column) {}
 
   std::int64_t getInteger() { return numValue.integer; }
   double getReal() { return numValue.real; }
-  std::string getString() const { return strValue; }
+  std::string getString() const { return std::string(text, length); }
   Type getType() { return type; }
 
   int getLine() const { return line; }
@@ -77,7 +81,8 @@ class Token {
     std::int64_t integer;
     double real;
   } numValue = {.integer = 0};
-  std::string strValue = "";
+  const char *text = "";
+  std::size_t length = 0;
   int line = 0;
   int column = 0;
 };
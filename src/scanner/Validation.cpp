@@ -4,25 +4,49 @@
 
 namespace validation {
 
-bool isValidIdentiferChar(char c) { return isalnum(c) || c == '_'; }
+namespace {
 
-bool isValidRealNumber(const std::string &value, int pointerPosition) {
-  for (int i = 0; i < value.size(); ++i) {
-    if (i != pointerPosition && !isdigit(value[i])) return false;
+constexpr CharClasses makeCharClasses() {
+  CharClasses classes{};
+  for (int c = 0; c < 128; ++c) {
+    bool digit = c >= '0' && c <= '9';
+    bool alpha = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+    bool graph = c > ' ' && c < 127;
+    std::uint8_t charClass = 0;
+    if (c == ' ' || (c >= '\t' && c <= '\r')) charClass |= Space;
+    if (digit) charClass |= Digit;
+    if (digit || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F'))
+      charClass |= HexDigit;
+    if (digit || alpha) charClass |= Alnum;
+    if (digit || alpha || c == '_') charClass |= Identifier;
+    if (graph && !digit && !alpha) charClass |= Punct;
+    if (graph) charClass |= Graph;
+    classes.of[c] = charClass;
   }
-  return value[pointerPosition] == '.';
+  return classes;
 }
 
-bool isValidIntegerNumber(const std::string &value) {
-  for (auto &digit : value) {
-    if (!isdigit(digit)) return false;
+}  // namespace
+
+extern const CharClasses charClasses = makeCharClasses();
+
+bool isValidRealNumber(const char *begin, const char *end, const char *point) {
+  for (auto c = begin; c != end; ++c) {
+    if (c != point && !is(*c, Digit)) return false;
+  }
+  return *point == '.';
+}
+
+bool isValidIntegerNumber(const char *begin, const char *end) {
+  for (auto digit = begin; digit != end; ++digit) {
+    if (!is(*digit, Digit)) return false;
   }
   return true;
 }
 
-bool isValidHexNumber(const std::string &value) {
-  for (auto &digit : value) {
-    if (!isxdigit(digit)) return false;
+bool isValidHexNumber(const char *begin, const char *end) {
+  for (auto digit = begin; digit != end; ++digit) {
+    if (!is(*digit, HexDigit)) return false;
   }
   return true;
 }
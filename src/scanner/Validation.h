@@ -3,15 +3,37 @@
 #ifndef SRC_SCANNER_VALIDATION_H_
 #define SRC_SCANNER_VALIDATION_H_
 
-#include <cctype>
-#include <string>
+#include <cstdint>
 
 namespace validation {
 
-bool isValidIdentiferChar(char c);
-bool isValidRealNumber(const std::string &value, int pointerPosition);
-bool isValidIntegerNumber(const std::string &value);
-bool isValidHexNumber(const std::string &value);
+// Classes of characters as in the "C" locale. Table is computed at compile
+// time, bytes outside of ASCII (and EOF) belong to no class.
+enum CharClass : std::uint8_t {
+  Space = 1,
+  Digit = 2,
+  HexDigit = 4,
+  Alnum = 8,
+  Identifier = 16,
+  Punct = 32,
+  Graph = 64
+};
+
+struct CharClasses {
+  std::uint8_t of[256];
+};
+
+extern const CharClasses charClasses;
+
+inline bool is(char c, CharClass charClass) {
+  return charClasses.of[static_cast<unsigned char>(c)] & charClass;
+}
+
+inline bool isValidIdentiferChar(char c) { return is(c, Identifier); }
+// Text of the number from `begin` to `end`
+bool isValidRealNumber(const char *begin, const char *end, const char *point);
+bool isValidIntegerNumber(const char *begin, const char *end);
+bool isValidHexNumber(const char *begin, const char *end);
 
 }  // namespace validation
 
@@ -1,9 +1,18 @@
 // Copyright 2019 Kamil Mankowski
 
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <random>
 #include <sstream>
+#include <stdexcept>
 
 #include <boost/test/unit_test.hpp>
+#include "../MappedFile.h"
 #include "../Scanner.h"
+#include "../Skip.h"
 
 namespace tt = boost::test_tools;
 using ttype = Token::Type;
@@ -26,6 +35,17 @@ BOOST_AUTO_TEST_CASE(test_integer_numbers_recognize) {
   }
 }
 
+BOOST_AUTO_TEST_CASE(test_integer_numbers_above_int_range) {
+  std::string program = "2147483648 0x7fffffffffffffff";
+  std::stringstream input(program);
+
+  Scanner scanner(input);
+  scanner.getNextToken();
+
+  BOOST_TEST(scanner.getNextToken().getInteger() == 2147483648L);
+  BOOST_TEST(scanner.getNextToken().getInteger() == INT64_MAX);
+}
+
 BOOST_AUTO_TEST_CASE(test_real_numbers_recognize) {
   std::string program = "12.3 0.5 9. 0. 0123.6";
   std::stringstream input(program);
@@ -87,6 +107,22 @@ BOOST_AUTO_TEST_CASE(test_controlkeywords_def_recognize) {
   }
 }
 
+BOOST_AUTO_TEST_CASE(test_identifiers_similar_to_keywords) {
+  std::string program = "Tru returns iff d e None_ _in x";
+  std::stringstream input(program);
+
+  Scanner scanner(input);
+  scanner.getNextToken();
+
+  std::string expected[] = {"Tru", "returns", "iff", "d",
+                            "e",   "None_",   "_in", "x"};
+  for (auto& expStr : expected) {
+    auto token = scanner.getNextToken();
+    BOOST_TEST((token.getType() == ttype::identifier));
+    BOOST_TEST(token.getString() == expStr);
+  }
+}
+
 BOOST_AUTO_TEST_CASE(test_whitespace_recognize_and_ignore) {
   std::string program = "   \n    a \t b\n";
   std::stringstream input(program);
@@ -235,6 +271,22 @@ BOOST_AUTO_TEST_CASE(test_invalid_token) {
   }
 }
 
+BOOST_AUTO_TEST_CASE(test_invalid_operator) {
+  std::string program = "!x %=";
+  std::stringstream input(program);
+  Token token;
+
+  Scanner scanner(input);
+  scanner.getNextToken();
+
+  std::string expected[] = {"!x", "%="};
+  for (auto& expStr : expected) {
+    token = scanner.getNextToken();
+    BOOST_TEST((token.getType() == ttype::NaT));
+    BOOST_TEST(token.getString() == expStr);
+  }
+}
+
 BOOST_AUTO_TEST_CASE(test_skip_comments) {
   std::string program = "valid_token # there is no more \nnext_token";
   std::stringstream input(program);
@@ -302,4 +354,113 @@ BOOST_AUTO_TEST_CASE(test_mixed_tokens) {
   }
 }
 
+BOOST_AUTO_TEST_CASE(test_source_longer_than_read_block) {
+  std::string program = "a = " + std::string(100000, 'x') + "\nb";
+  std::stringstream input(program);
+
+  Scanner scanner(input);
+  scanner.getNextToken();
+  scanner.getNextToken();
+  scanner.getNextToken();
+
+  auto token = scanner.getNextToken();
+  BOOST_TEST((token.getType() == ttype::identifier));
+  BOOST_TEST(token.getString().size() == 100000);
+  BOOST_TEST((scanner.getNextToken().getType() == ttype::nl));
+  scanner.getNextToken();
+  token = scanner.getNextToken();
+  BOOST_TEST((token.getType() == ttype::identifier));
+  BOOST_TEST(token.getString() == "b");
+  BOOST_TEST((scanner.getNextToken().getType() == ttype::eof));
+}
+
+BOOST_AUTO_TEST_CASE(test_scan_source_range) {
+  std::string program = "x = 1 # rest\nnot scanned";
+  auto begin = program.data();
+
+  Scanner scanner(begin, begin + program.find('\n'));
+
+  ttype expected[] = {ttype::space, ttype::identifier, ttype::assign,
+                      ttype::integerNumber, ttype::eof};
+  Token identifier;
+  for (auto& expType : expected) {
+    auto token = scanner.getNextToken();
+    BOOST_TEST((token.getType() == expType));
+    if (expType == ttype::identifier) identifier = token;
+  }
+  BOOST_TEST(identifier.getString() == "x");
+}
+
+BOOST_AUTO_TEST_CASE(test_scan_mapped_file) {
+  char path[] = "/tmp/tkom_scannerXXXXXX";
+  int fd = mkstemp(path);
+  BOOST_REQUIRE(fd >= 0);
+  close(fd);
+  std::ofstream(path) << "print(\"mapped\")";
+
+  {
+    MappedFile file(path);
+    Scanner scanner(file.begin(), file.end());
+    scanner.getNextToken();
+    auto token = scanner.getNextToken();
+    BOOST_TEST(token.getString() == "print");
+  }
+  std::remove(path);
+
+  BOOST_CHECK_THROW(MappedFile file(path), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(test_skip_implementations_agree) {
+  std::string alphabet = "  \t\r\v\fa_Z9#\"\n.(\xc5\x80";
+  std::mt19937 random(2019);
+  std::string source;
+  for (int i = 0; i < 4000; ++i) {
+    // Long runs of one character cross the vector width
+    std::size_t length = random() % 3 == 0 ? random() % 70 : 1;
+    source.append(length, alphabet[random() % alphabet.size()]);
+  }
+  auto begin = source.data(), end = begin + source.size();
+
+  auto implementations = skip::available();
+  auto& scalar = *implementations.back();
+  BOOST_TEST(scalar.name == "scalar");
+  for (auto implementation : implementations) {
+    for (auto position = begin; position != end; ++position) {
+      BOOST_REQUIRE(implementation->spaces(position, end) ==
+                    scalar.spaces(position, end));
+      BOOST_REQUIRE(implementation->identifier(position, end) ==
+                    scalar.identifier(position, end));
+      BOOST_REQUIRE(implementation->line(position, end) ==
+                    scalar.line(position, end));
+      BOOST_REQUIRE(implementation->text(position, end) ==
+                    scalar.text(position, end));
+      BOOST_REQUIRE(skip::spaces(position, end) ==
+                    scalar.spaces(position, end));
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(test_long_comments_and_strings) {
+  std::string comment(100, '#');
+  std::string text(100, 'x');
+  std::string program = "a  " + std::string(40, ' ') + comment + "\n\"" +
+                        text + "\" " + std::string(50, 'b') + "\n\"" + text;
+  std::stringstream input(program);
+
+  Scanner scanner(input);
+  scanner.getNextToken();
+  BOOST_TEST(scanner.getNextToken().getString() == "a");
+  BOOST_TEST((scanner.getNextToken().getType() == ttype::nl));
+  scanner.getNextToken();
+  BOOST_TEST(scanner.getNextToken().getString() == text);
+  auto token = scanner.getNextToken();
+  BOOST_TEST(token.getString() == std::string(50, 'b'));
+  BOOST_TEST(token.getColumn() == 153);
+  scanner.getNextToken();
+  scanner.getNextToken();
+  token = scanner.getNextToken();
+  BOOST_TEST((token.getType() == ttype::NaT));
+  BOOST_TEST(token.getString() == text);
+}
+
 BOOST_AUTO_TEST_SUITE_END()